@@ -0,0 +1,90 @@
+#ifndef __CORPUSGENERATOR_HPP__
+#define __CORPUSGENERATOR_HPP__
+
+#include <string>
+#include <vector>
+#include <random>
+#include <fstream>
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+
+namespace Darwin {
+    using namespace std;
+
+    // writes a deterministic synthetic corpus: the same options give byte-identical files
+    // on every platform. words are drawn from a Zipf distribution over the vocabulary, the
+    // word of rank r (0 is the most frequent) is spelled from r so it can be searched for
+    class CorpusGenerator {
+        public:
+            struct Options {
+                size_t docNum = 100;
+                size_t lineNum = 1000;
+                size_t wordsPerLine = 10;
+                size_t vocabularySize = 50000;
+                double zipfExponent = 1.0;
+                uint64_t seed = 42;
+            };
+
+        private:
+            Options _options;
+            vector<double> _cdf;
+            mt19937_64 _rng;
+
+        public:
+            explicit CorpusGenerator(const Options& options) :
+                _options(options), _cdf(options.vocabularySize), _rng(options.seed) {
+                double sum = 0;
+                for (size_t rank = 0; rank < _cdf.size(); rank++) {
+                    sum += 1.0 / pow(static_cast<double>(rank + 1), _options.zipfExponent);
+                    _cdf[rank] = sum;
+                }
+                for (auto& c : _cdf) c /= sum;
+            }
+
+            static string word(size_t rank) {
+                string ret;
+                do {
+                    ret.push_back(static_cast<char>('a' + rank % 26));
+                    rank /= 26;
+                } while (rank != 0);
+                return ret;
+            }
+
+            size_t nextRank() {
+                // mt19937_64 output is fixed by the standard, the distributions are not
+                double u = static_cast<double>(_rng() >> 11) * (1.0 / 9007199254740992.0);
+                return min(static_cast<size_t>(lower_bound(_cdf.begin(), _cdf.end(), u) - _cdf.begin()), _cdf.size() - 1);
+            }
+
+            string line() {
+                string ret;
+                for (size_t i = 0; i < _options.wordsPerLine; i++) {
+                    if (i != 0) ret.push_back(' ');
+                    ret += word(nextRank());
+                }
+                return ret;
+            }
+
+            // directory/documents lists directory/doc<i> in the format IndexBuilder::build reads,
+            // returns the number of bytes written to the documents
+            size_t write(const string& directory) {
+                size_t bytes = 0;
+                ofstream documents(directory + "/documents");
+                for (size_t d = 0; d < _options.docNum; d++) {
+                    string docName = "doc" + to_string(d);
+                    documents << d + 1 << " " << docName << "\n";
+
+                    ofstream doc(directory + "/" + docName);
+                    for (size_t l = 0; l < _options.lineNum; l++) {
+                        string content = line();
+                        doc << content << "\n";
+                        bytes += content.length() + 1;
+                    }
+                }
+                return bytes;
+            }
+    };
+}
+
+#endif
@@ -0,0 +1,356 @@
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <algorithm>
+#include <cstdlib>
+#include <cstdio>
+#include <sys/stat.h>
+#include "darwin.hpp"
+#include "Tokenizer.hpp"
+#include "IndexBuilder.hpp"
+#include "Serializer.hpp"
+#include "LazyIndex.hpp"
+#include "FrozenIndex.hpp"
+#include "ExternalIndexBuilder.hpp"
+#include "CorpusGenerator.hpp"
+
+using namespace Darwin;
+
+// every benchmark prints one JSON object per line to stdout:
+//   {"benchmark": ..., "iterations": ..., "bytes": ..., "mb_per_s": ..., "ops_per_s": ...,
+//    "p50_us": ..., "p90_us": ..., "p99_us": ..., "max_us": ...}
+// bytes and mb_per_s are per iteration input bytes, ops_per_s counts iterations
+
+namespace {
+    using Clock = chrono::steady_clock;
+
+    struct Options {
+        CorpusGenerator::Options corpus;
+        string directory = "corpus";
+        size_t repeat = 5;
+        size_t queries = 1000;
+        size_t threadNum = 4;
+    };
+
+    double elapsedUs(Clock::time_point begin) {
+        return chrono::duration<double, micro>(Clock::now() - begin).count();
+    }
+
+    double percentile(const vector<double>& sorted, double p) {
+        if (sorted.empty()) return 0;
+        size_t rank = static_cast<size_t>(p * (sorted.size() - 1) + 0.5);
+        return sorted[rank];
+    }
+
+    void report(const string& benchmark, vector<double> latencies, size_t bytes, const string& extra = "") {
+        sort(latencies.begin(), latencies.end());
+        double total = 0;
+        for (auto l : latencies) total += l;
+        double seconds = total / 1e6;
+
+        ostringstream out;
+        out << "{\"benchmark\": \"" << benchmark << "\""
+            << ", \"iterations\": " << latencies.size()
+            << ", \"bytes\": " << bytes
+            << ", \"mb_per_s\": " << (seconds > 0 ? bytes * latencies.size() / seconds / 1e6 : 0)
+            << ", \"ops_per_s\": " << (seconds > 0 ? latencies.size() / seconds : 0)
+            << ", \"p50_us\": " << percentile(latencies, 0.5)
+            << ", \"p90_us\": " << percentile(latencies, 0.9)
+            << ", \"p99_us\": " << percentile(latencies, 0.99)
+            << ", \"max_us\": " << (latencies.empty() ? 0 : latencies.back());
+        if (!extra.empty()) out << ", " << extra;
+        out << "}";
+        cout << out.str() << endl;
+    }
+
+    size_t fileSize(const string& fileName) {
+        struct stat st;
+        if (stat(fileName.c_str(), &st) != 0) return 0;
+        return st.st_size;
+    }
+
+    void usage(const char* name) {
+        cerr << "usage: " << name << " [--docs N] [--lines N] [--words N] [--vocab N] [--zipf S]"
+             << " [--seed N] [--threads N] [--repeat N] [--queries N] [--dir DIR]" << endl;
+    }
+
+    bool parseOptions(int argc, char** argv, Options& options) {
+        for (int i = 1; i < argc; i++) {
+            string arg = argv[i];
+            if (i + 1 == argc) return false;
+            string value = argv[++i];
+            if (arg == "--docs") options.corpus.docNum = stoul(value);
+            else if (arg == "--lines") options.corpus.lineNum = stoul(value);
+            else if (arg == "--words") options.corpus.wordsPerLine = stoul(value);
+            else if (arg == "--vocab") options.corpus.vocabularySize = stoul(value);
+            else if (arg == "--zipf") options.corpus.zipfExponent = stod(value);
+            else if (arg == "--seed") options.corpus.seed = stoull(value);
+            else if (arg == "--threads") options.threadNum = stoul(value);
+            else if (arg == "--repeat") options.repeat = stoul(value);
+            else if (arg == "--queries") options.queries = stoul(value);
+            else if (arg == "--dir") options.directory = value;
+            else return false;
+        }
+        return options.repeat > 0 && options.corpus.vocabularySize > 0;
+    }
+
+    void benchTokenize(const Options& options) {
+        // one document in memory, tokenized into a fresh tokenizer every iteration
+        vector<string> lines;
+        size_t bytes = 0;
+        ifstream doc(options.directory + "/doc0");
+        string line;
+        while (getline(doc, line)) {
+            bytes += line.length() + 1;
+            lines.push_back(line);
+        }
+
+        vector<double> latencies;
+        for (size_t r = 0; r < options.repeat; r++) {
+            Tokenizer tokenizer;
+            auto begin = Clock::now();
+            for (const auto& l : lines) tokenizer.tokenize(l);
+            latencies.push_back(elapsedUs(begin));
+        }
+        report("tokenize", latencies, bytes);
+    }
+
+    void benchBuild(const Options& options, size_t corpusBytes, size_t threadNum) {
+        vector<double> latencies;
+        for (size_t r = 0; r < options.repeat; r++) {
+            IndexBuilder indexBuilder((Tokenizer()));
+            auto begin = Clock::now();
+            indexBuilder.build(options.directory + "/documents", threadNum);
+            latencies.push_back(elapsedUs(begin));
+        }
+        report(threadNum > 1 ? "build_parallel" : "build", latencies, corpusBytes,
+               "\"threads\": " + to_string(threadNum));
+    }
+
+    void benchBuildExternal(const Options& options, size_t corpusBytes) {
+        // a budget of an eighth of the corpus forces several runs
+        const string fname = options.directory + "/external.dump";
+        vector<double> latencies;
+        size_t runNum = 0;
+        for (size_t r = 0; r < options.repeat; r++) {
+            ExternalIndexBuilder externalBuilder(Tokenizer(), max<size_t>(1, corpusBytes / 8));
+            auto begin = Clock::now();
+            externalBuilder.build(options.directory + "/documents", fname);
+            latencies.push_back(elapsedUs(begin));
+            runNum = externalBuilder.runNum();
+        }
+        report("build_external", latencies, corpusBytes, "\"runs\": " + to_string(runNum));
+    }
+
+    void benchSearch(const Options& options, const IndexBuilder& indexBuilder) {
+        // hot is the most frequent word, cold the rarest one that made it into the
+        // corpus, absent a word the generator cannot spell
+        string hot = CorpusGenerator::word(0);
+        string cold;
+        for (size_t rank = options.corpus.vocabularySize; rank-- > 0; ) {
+            cold = CorpusGenerator::word(rank);
+            if (indexBuilder.getWordId(cold) != 0) break;
+        }
+        string absent = "0absent";
+
+        vector<pair<string, string>> cases = {{"search_hot", hot}, {"search_cold", cold}, {"search_absent", absent}};
+        for (const auto& c : cases) {
+            vector<double> latencies;
+            size_t hits = 0;
+            // every hit reads a line from disk, keep hot searches to a sane count
+            size_t queries = (c.first == "search_hot" ? max<size_t>(1, options.queries / 100) : options.queries);
+            for (size_t q = 0; q < queries; q++) {
+                auto begin = Clock::now();
+                hits = indexBuilder.search(c.second).size();
+                latencies.push_back(elapsedUs(begin));
+            }
+            report(c.first, latencies, 0, "\"word\": \"" + c.second + "\", \"hits\": " + to_string(hits));
+        }
+
+        // ranked disjunction of a frequent, a mid and a rare word
+        string query = hot + " " + CorpusGenerator::word(options.corpus.vocabularySize / 100) + " " + cold;
+        vector<double> latencies;
+        for (size_t q = 0; q < options.queries; q++) {
+            auto begin = Clock::now();
+            indexBuilder.searchTopK(query, 10);
+            latencies.push_back(elapsedUs(begin));
+        }
+        report("search_top10", latencies, 0, "\"query\": \"" + query + "\"");
+
+        // every word sharing the first bytes of the rare word, expanded from the term dictionary
+        string pattern = cold.substr(0, min<size_t>(3, cold.length())) + "*";
+        vector<double> prefixLatencies;
+        size_t prefixHits = 0;
+        for (size_t q = 0; q < max<size_t>(1, options.queries / 10); q++) {
+            auto begin = Clock::now();
+            prefixHits = indexBuilder.searchWildcard(pattern).size();
+            prefixLatencies.push_back(elapsedUs(begin));
+        }
+        report("search_prefix", prefixLatencies, 0, "\"pattern\": \"" + pattern + "\", \"hits\": " + to_string(prefixHits) +
+               ", \"dictionary_bytes\": " + to_string(indexBuilder.terms().bytes()));
+
+        // the rare word with its last byte dropped, one edit away from it
+        string misspelled = cold.substr(0, cold.length() - 1);
+        vector<double> fuzzyLatencies;
+        size_t fuzzyHits = 0;
+        for (size_t q = 0; q < max<size_t>(1, options.queries / 10); q++) {
+            auto begin = Clock::now();
+            fuzzyHits = indexBuilder.searchFuzzy(misspelled).size();
+            fuzzyLatencies.push_back(elapsedUs(begin));
+        }
+        report("search_fuzzy", fuzzyLatencies, 0, "\"word\": \"" + misspelled + "\", \"hits\": " + to_string(fuzzyHits));
+    }
+
+    void benchFreeze(const Options& options, const IndexBuilder& indexBuilder) {
+        vector<double> latencies;
+        size_t bytes = 0;
+        for (size_t r = 0; r < options.repeat; r++) {
+            auto begin = Clock::now();
+            bytes = indexBuilder.freeze().bytes();
+            latencies.push_back(elapsedUs(begin));
+        }
+        report("freeze", latencies, bytes);
+
+        // postings lookups only, lines are not fetched
+        FrozenIndex index = indexBuilder.freeze();
+        vector<string> words;
+        for (size_t q = 0; q < options.queries; q++) words.push_back(CorpusGenerator::word(q % options.corpus.vocabularySize));
+        vector<double> frozenLatencies;
+        size_t hits = 0;
+        for (size_t r = 0; r < options.repeat; r++) {
+            hits = 0;
+            auto begin = Clock::now();
+            for (const auto& word : words) hits += index.postings(word).size();
+            frozenLatencies.push_back(elapsedUs(begin) / words.size());
+        }
+        report("lookup_frozen", frozenLatencies, 0, "\"hits\": " + to_string(hits));
+    }
+
+    void benchSubstring(const Options& options, const IndexBuilder& indexBuilder) {
+        vector<double> buildLatencies;
+        IndexBuilder trigramBuilder((Tokenizer()));
+        for (size_t r = 0; r < options.repeat; r++) {
+            trigramBuilder = IndexBuilder((Tokenizer()));
+            auto begin = Clock::now();
+            trigramBuilder.build(options.directory + "/documents", 1, true);
+            buildLatencies.push_back(elapsedUs(begin));
+        }
+        report("build_trigrams", buildLatencies, 0, "\"trigrams\": " + to_string(trigramBuilder.trigrams().size()));
+
+        // the tail of a rare word, a full scan reads every line to find it
+        string cold;
+        for (size_t rank = options.corpus.vocabularySize; rank-- > 0; ) {
+            cold = CorpusGenerator::word(rank);
+            if (indexBuilder.getWordId(cold) != 0) break;
+        }
+        string pattern = cold.substr(cold.length() > 4 ? 1 : 0);
+        vector<pair<string, const IndexBuilder*>> cases = {{"substring_scan", &indexBuilder}, {"substring_trigram", &trigramBuilder}};
+        for (const auto& c : cases) {
+            vector<double> latencies;
+            size_t hits = 0;
+            for (size_t r = 0; r < options.repeat; r++) {
+                auto begin = Clock::now();
+                hits = c.second->searchSubstring(pattern).size();
+                latencies.push_back(elapsedUs(begin));
+            }
+            report(c.first, latencies, 0, "\"pattern\": \"" + pattern + "\", \"hits\": " + to_string(hits));
+        }
+    }
+
+    void benchPhrase(const Options& options) {
+        vector<double> buildLatencies;
+        IndexBuilder positionBuilder((Tokenizer()));
+        for (size_t r = 0; r < options.repeat; r++) {
+            positionBuilder = IndexBuilder((Tokenizer()));
+            auto begin = Clock::now();
+            positionBuilder.build(options.directory + "/documents", 1, false, true);
+            buildLatencies.push_back(elapsedUs(begin));
+        }
+        report("build_positions", buildLatencies, 0, "\"position_bytes\": " + to_string(positionBuilder.positions().bytes()));
+
+        // the two most frequent words, as a phrase and within a few words of each other
+        string first = CorpusGenerator::word(0);
+        string second = CorpusGenerator::word(1);
+        vector<double> phraseLatencies;
+        vector<double> nearLatencies;
+        size_t phraseHits = 0;
+        size_t nearHits = 0;
+        for (size_t q = 0; q < max<size_t>(1, options.queries / 100); q++) {
+            auto begin = Clock::now();
+            phraseHits = positionBuilder.searchPhrase(first + " " + second).size();
+            phraseLatencies.push_back(elapsedUs(begin));
+            begin = Clock::now();
+            nearHits = positionBuilder.searchNear(first, second, 3).size();
+            nearLatencies.push_back(elapsedUs(begin));
+        }
+        string words = "\"words\": \"" + first + " " + second + "\"";
+        report("search_phrase", phraseLatencies, 0, words + ", \"hits\": " + to_string(phraseHits));
+        report("search_near3", nearLatencies, 0, words + ", \"hits\": " + to_string(nearHits));
+    }
+
+    void benchSerializer(const Options& options, const IndexBuilder& indexBuilder) {
+        const string fname = options.directory + "/index.dump";
+        Serializer serializer;
+
+        vector<double> dumpLatencies;
+        vector<double> loadLatencies;
+        vector<double> lazyLatencies;
+        string word = CorpusGenerator::word(0);
+        for (size_t r = 0; r < options.repeat; r++) {
+            auto begin = Clock::now();
+            serializer.serialize(fname, indexBuilder);
+            dumpLatencies.push_back(elapsedUs(begin));
+
+            IndexBuilder backupIndexBuilder((Tokenizer()));
+            begin = Clock::now();
+            serializer.deserialize(fname, backupIndexBuilder);
+            loadLatencies.push_back(elapsedUs(begin));
+
+            // time to the postings of the first query, lines are not fetched
+            begin = Clock::now();
+            LazyIndex lazyIndex(fname);
+            lazyIndex.postings(word);
+            lazyLatencies.push_back(elapsedUs(begin));
+        }
+        report("serialize", dumpLatencies, fileSize(fname));
+        report("deserialize", loadLatencies, fileSize(fname));
+        report("lazy_open", lazyLatencies, fileSize(fname));
+    }
+}
+
+int main(int argc, char** argv) {
+    Options options;
+    if (!parseOptions(argc, argv, options)) {
+        usage(argv[0]);
+        return 1;
+    }
+
+    mkdir(options.directory.c_str(), 0755);
+    CorpusGenerator generator(options.corpus);
+    auto begin = Clock::now();
+    size_t corpusBytes = generator.write(options.directory);
+    report("generate", {elapsedUs(begin)}, corpusBytes,
+           "\"docs\": " + to_string(options.corpus.docNum) +
+           ", \"lines\": " + to_string(options.corpus.lineNum) +
+           ", \"words\": " + to_string(options.corpus.wordsPerLine) +
+           ", \"vocab\": " + to_string(options.corpus.vocabularySize) +
+           ", \"zipf\": " + to_string(options.corpus.zipfExponent) +
+           ", \"seed\": " + to_string(options.corpus.seed));
+
+    benchTokenize(options);
+    benchBuild(options, corpusBytes, 1);
+    if (options.threadNum > 1) benchBuild(options, corpusBytes, options.threadNum);
+    benchBuildExternal(options, corpusBytes);
+
+    IndexBuilder indexBuilder((Tokenizer()));
+    indexBuilder.build(options.directory + "/documents");
+    benchSearch(options, indexBuilder);
+    benchFreeze(options, indexBuilder);
+    benchSubstring(options, indexBuilder);
+    benchPhrase(options);
+    benchSerializer(options, indexBuilder);
+    return 0;
+}
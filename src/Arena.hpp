@@ -0,0 +1,100 @@
+#ifndef __ARENA_HPP__
+#define __ARENA_HPP__
+
+#include <vector>
+#include <memory>
+#include <cstddef>
+#include <cstring>
+#include "darwin.hpp"
+
+namespace Darwin {
+    // monotonic allocator: memory is bumped out of large blocks and only given back,
+    // all at once, when the arena is destroyed. deallocating is a no-op, so it suits
+    // structures that grow during a build and are dropped as a whole
+    class Arena {
+        private:
+            static const size_t _blockSize = 64 << 10;
+
+            vector<unique_ptr<char[]>> _blocks;
+            char* _pos = nullptr;
+            char* _end = nullptr;
+            size_t _bytes = 0;
+            size_t _capacity = 0;
+
+        public:
+            Arena() {}
+            Arena(const Arena&) = delete;
+            Arena& operator = (const Arena&) = delete;
+
+            // align must be a power of two no larger than alignof(max_align_t)
+            void* allocate(size_t size, size_t align = alignof(max_align_t)) {
+                size_t padding = (align - reinterpret_cast<uintptr_t>(_pos) % align) % align;
+                if (_pos == nullptr || static_cast<size_t>(_end - _pos) < size + padding) {
+                    // a request larger than a block gets a block of its own and the
+                    // current block is kept for the small ones that follow
+                    if (size > _blockSize / 4) return _newBlock(size);
+                    _pos = _newBlock(_blockSize);
+                    _end = _pos + _blockSize;
+                    padding = 0;
+                }
+                char* ret = _pos + padding;
+                _pos = ret + size;
+                _bytes += size;
+                return ret;
+            }
+
+            // a copy of str that lives as long as the arena
+            StringRef copy(StringRef str) {
+                char* data = static_cast<char*>(allocate(str.length(), 1));
+                if (!str.empty()) memcpy(data, str.data(), str.length());
+                return StringRef(data, str.length());
+            }
+
+            // bytes handed out and bytes reserved from the system
+            size_t bytes() const { return _bytes; }
+            size_t capacity() const { return _capacity; }
+
+        private:
+            char* _newBlock(size_t size) {
+                _blocks.emplace_back(new char[size]);
+                _capacity += size;
+                return _blocks.back().get();
+            }
+    };
+
+    // standard allocator interface over an Arena, for containers built in one go that never
+    // give memory back while they grow, such as a std::map. an unordered_map would strand its
+    // bucket array on every rehash. containers move and swap their arena along with their elements
+    template <typename T>
+    class ArenaAllocator {
+        template <typename U>
+        friend class ArenaAllocator;
+
+        private:
+            Arena* _arena;
+
+        public:
+            using value_type = T;
+            using propagate_on_container_copy_assignment = true_type;
+            using propagate_on_container_move_assignment = true_type;
+            using propagate_on_container_swap = true_type;
+
+            explicit ArenaAllocator(Arena* arena) : _arena(arena) {}
+            template <typename U>
+            ArenaAllocator(const ArenaAllocator<U>& rhs) : _arena(rhs._arena) {}
+
+            T* allocate(size_t n) {
+                return static_cast<T*>(_arena->allocate(n * sizeof(T), alignof(T)));
+            }
+            void deallocate(T*, size_t) {}
+
+            Arena* arena() const { return _arena; }
+
+            template <typename U>
+            bool operator == (const ArenaAllocator<U>& rhs) const { return _arena == rhs._arena; }
+            template <typename U>
+            bool operator != (const ArenaAllocator<U>& rhs) const { return _arena != rhs._arena; }
+    };
+}
+
+#endif
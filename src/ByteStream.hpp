@@ -0,0 +1,297 @@
+#ifndef __BYTESTREAM_HPP__
+#define __BYTESTREAM_HPP__
+
+#include <string>
+#include <vector>
+#include <iostream>
+#include <cstring>
+#include <cerrno>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+namespace Darwin {
+    using namespace std;
+
+    // byte sink the serializer writes to. small writes are copied into a buffer with an
+    // inlined fast path, the sink only sees whole buffers (or writes larger than one)
+    class ByteSink {
+        private:
+            vector<char> _buffer;
+            size_t _pos = 0;
+
+        protected:
+            virtual void _flush(const char* data, size_t size) = 0;
+
+        public:
+            explicit ByteSink(size_t bufferSize) : _buffer(bufferSize) {}
+            ByteSink(const ByteSink&) = delete;
+            ByteSink& operator = (const ByteSink&) = delete;
+            // derived sinks flush in their own destructor, this one cannot call _flush
+            virtual ~ByteSink() {}
+
+            void write(const char* data, size_t size) {
+                if (size <= _buffer.size() - _pos) {
+                    if (size != 0) memcpy(_buffer.data() + _pos, data, size);
+                    _pos += size;
+                    return;
+                }
+                flush();
+                if (size >= _buffer.size()) {
+                    _flush(data, size);
+                    return;
+                }
+                memcpy(_buffer.data(), data, size);
+                _pos = size;
+            }
+
+            void flush() {
+                if (_pos == 0) return;
+                _flush(_buffer.data(), _pos);
+                _pos = 0;
+            }
+    };
+
+    // byte source the deserializer reads from. reads are served from [_pos, _end),
+    // the source refills that window when it runs dry
+    class ByteSource {
+        protected:
+            const char* _pos = nullptr;
+            const char* _end = nullptr;
+            bool _good = true;
+
+            // makes more bytes available in [_pos, _end), false at the end of the input
+            virtual bool _refill() = 0;
+
+            // the slow path of read, sources override it to read large blocks directly
+            virtual bool _read(char* data, size_t size) {
+                while (size != 0) {
+                    if (_pos == _end && !_refill()) return false;
+                    size_t n = min(size, static_cast<size_t>(_end - _pos));
+                    memcpy(data, _pos, n);
+                    _pos += n;
+                    data += n;
+                    size -= n;
+                }
+                return true;
+            }
+
+        public:
+            ByteSource() {}
+            ByteSource(const ByteSource&) = delete;
+            ByteSource& operator = (const ByteSource&) = delete;
+            virtual ~ByteSource() {}
+
+            // a read past the end of the input zero fills data and clears good()
+            bool read(char* data, size_t size) {
+                if (size <= static_cast<size_t>(_end - _pos)) {
+                    if (size != 0) memcpy(data, _pos, size);
+                    _pos += size;
+                    return true;
+                }
+                if (_read(data, size)) return true;
+                memset(data, 0, size);
+                _good = false;
+                return false;
+            }
+
+            bool good() const { return _good; }
+    };
+
+    // appends to an in-memory vector
+    class VectorSink : public ByteSink {
+        private:
+            vector<char> _data;
+
+        protected:
+            virtual void _flush(const char* data, size_t size) override {
+                _data.insert(_data.end(), data, data + size);
+            }
+
+        public:
+            explicit VectorSink(size_t bufferSize = 1 << 16) : ByteSink(bufferSize) {}
+            virtual ~VectorSink() { flush(); }
+
+            const vector<char>& data() {
+                flush();
+                return _data;
+            }
+    };
+
+    // buffered writes to a file descriptor
+    class FileSink : public ByteSink {
+        private:
+            int _fd;
+            bool _good = true;
+
+        protected:
+            virtual void _flush(const char* data, size_t size) override {
+                while (size != 0 && _good) {
+                    ssize_t n = ::write(_fd, data, size);
+                    if (n < 0 && errno == EINTR) continue;
+                    if (n <= 0) {
+                        _good = false;
+                        return;
+                    }
+                    data += n;
+                    size -= n;
+                }
+            }
+
+        public:
+            explicit FileSink(const string& fileName, size_t bufferSize = 1 << 20) :
+                ByteSink(bufferSize), _fd(::open(fileName.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644)) {
+                _good = (_fd >= 0);
+            }
+            virtual ~FileSink() { close(); }
+
+            bool is_open() const { return _fd >= 0; }
+            bool good() const { return _good; }
+
+            void close() {
+                if (_fd < 0) return;
+                flush();
+                ::close(_fd);
+                _fd = -1;
+            }
+    };
+
+    // buffers in front of an ostream, flushed into it when the sink goes away
+    class StreamSink : public ByteSink {
+        private:
+            ostream& _out;
+
+        protected:
+            virtual void _flush(const char* data, size_t size) override {
+                _out.write(data, size);
+            }
+
+        public:
+            explicit StreamSink(ostream& out, size_t bufferSize = 1 << 16) : ByteSink(bufferSize), _out(out) {}
+            virtual ~StreamSink() { flush(); }
+    };
+
+    // reads from memory owned by someone else
+    class MemorySource : public ByteSource {
+        protected:
+            virtual bool _refill() override { return false; }
+
+        public:
+            MemorySource(const char* data, size_t size) {
+                _pos = data;
+                _end = data + size;
+            }
+            explicit MemorySource(const vector<char>& data) : MemorySource(data.data(), data.size()) {}
+    };
+
+    // buffered reads from a file descriptor, reads larger than the buffer bypass it
+    class FileSource : public ByteSource {
+        private:
+            int _fd;
+            vector<char> _buffer;
+            // bytes read from the file so far
+            size_t _offset = 0;
+
+            ssize_t _readFd(char* data, size_t size) {
+                while (true) {
+                    ssize_t n = ::read(_fd, data, size);
+                    if (n < 0 && errno == EINTR) continue;
+                    if (n > 0) _offset += n;
+                    return n;
+                }
+            }
+
+        protected:
+            virtual bool _refill() override {
+                if (_fd < 0) return false;
+                ssize_t n = _readFd(_buffer.data(), _buffer.size());
+                if (n <= 0) return false;
+                _pos = _buffer.data();
+                _end = _pos + n;
+                return true;
+            }
+
+            virtual bool _read(char* data, size_t size) override {
+                // nothing is buffered before the first refill, when _pos is still null
+                size_t n = _end - _pos;
+                if (n != 0) memcpy(data, _pos, n);
+                _pos = _end;
+                data += n;
+                size -= n;
+
+                while (size >= _buffer.size()) {
+                    if (_fd < 0) return false;
+                    ssize_t r = _readFd(data, size);
+                    if (r <= 0) return false;
+                    data += r;
+                    size -= r;
+                }
+                return ByteSource::_read(data, size);
+            }
+
+        public:
+            explicit FileSource(const string& fileName, size_t bufferSize = 1 << 20) :
+                _fd(::open(fileName.c_str(), O_RDONLY)), _buffer(bufferSize) {
+                if (_fd < 0) _good = false;
+            }
+            virtual ~FileSource() {
+                if (_fd >= 0) ::close(_fd);
+            }
+
+            bool is_open() const { return _fd >= 0; }
+
+            // file offset of the next byte read returns
+            size_t tell() const { return _offset - (_end - _pos); }
+    };
+
+    // maps the whole file and reads it like memory
+    class MappedSource : public ByteSource {
+        private:
+            void* _base = MAP_FAILED;
+            size_t _length = 0;
+
+        protected:
+            virtual bool _refill() override { return false; }
+
+        public:
+            explicit MappedSource(const string& fileName) {
+                int fd = ::open(fileName.c_str(), O_RDONLY);
+                struct stat st;
+                if (fd >= 0 && fstat(fd, &st) == 0 && st.st_size > 0) {
+                    _length = st.st_size;
+                    _base = mmap(nullptr, _length, PROT_READ, MAP_PRIVATE, fd, 0);
+                }
+                if (fd >= 0) ::close(fd);
+                if (_base == MAP_FAILED) {
+                    _good = (fd >= 0);
+                    return;
+                }
+#ifdef MADV_SEQUENTIAL
+                madvise(_base, _length, MADV_SEQUENTIAL);
+#endif
+                _pos = static_cast<const char*>(_base);
+                _end = _pos + _length;
+            }
+            virtual ~MappedSource() {
+                if (_base != MAP_FAILED) munmap(_base, _length);
+            }
+    };
+
+    // unbuffered reads from an istream, nothing is consumed past what was asked for
+    class StreamSource : public ByteSource {
+        private:
+            istream& _in;
+
+        protected:
+            virtual bool _refill() override { return false; }
+            virtual bool _read(char* data, size_t size) override {
+                return static_cast<bool>(_in.read(data, size));
+            }
+
+        public:
+            explicit StreamSource(istream& in) : _in(in) {}
+    };
+}
+
+#endif
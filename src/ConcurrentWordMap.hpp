@@ -0,0 +1,235 @@
+#ifndef __CONCURRENTWORDMAP_HPP__
+#define __CONCURRENTWORDMAP_HPP__
+
+#include <string>
+#include <vector>
+#include <atomic>
+#include <mutex>
+#include <memory>
+#include "darwin.hpp"
+#include "Serializer.hpp"
+#include "Tokenizer.hpp"
+
+namespace Darwin {
+    // word dictionary that many threads can fill at once. the words are spread over
+    // lock-striped shards, every shard is an open addressing table of atomic entry
+    // pointers: inserts take the shard lock, lookups never lock. a full table is copied
+    // into one twice its size and the old one is kept alive until destruction, so a
+    // reader still probing it stays valid. ids are handed out once and never change
+    class ConcurrentWordMap {
+        friend SerializeFunc<ConcurrentWordMap>;
+        friend DeserializeFunc<ConcurrentWordMap>;
+
+        private:
+            struct Entry {
+                string word;
+                WordIdType wordId;
+                size_t hash;
+                Entry(StringRef word, WordIdType wordId, size_t hash) :
+                    word(word.str()), wordId(wordId), hash(hash) {}
+            };
+
+            struct Table {
+                size_t mask;
+                unique_ptr<atomic<Entry*>[]> slots;
+                explicit Table(size_t capacity) :
+                    mask(capacity - 1), slots(new atomic<Entry*>[capacity]) {
+                    for (size_t i = 0; i < capacity; i++) slots[i].store(nullptr, memory_order_relaxed);
+                }
+            };
+
+            struct Shard {
+                mutex lock;
+                atomic<Table*> table;
+                vector<unique_ptr<Table>> tables;
+                vector<unique_ptr<Entry>> entries;
+                Shard() : table(nullptr) {
+                    tables.push_back(unique_ptr<Table>(new Table(16)));
+                    table.store(tables.back().get(), memory_order_release);
+                }
+            };
+
+            static const size_t _shardBits = 6;
+            static const size_t _shardNum = 1 << _shardBits;
+
+            unique_ptr<Shard[]> _shards;
+            atomic<WordIdType> _maxWordId;
+
+        public:
+            using value_type = pair<const string, WordIdType>;
+            using size_type = size_t;
+
+            ConcurrentWordMap() : _shards(new Shard[_shardNum]), _maxWordId(0) {}
+            ConcurrentWordMap(const ConcurrentWordMap& rhs) : ConcurrentWordMap() {
+                rhs.forEach([this] (StringRef word, WordIdType wordId) { _emplace(word, wordId); });
+            }
+            ConcurrentWordMap(ConcurrentWordMap&& rhs) : ConcurrentWordMap() {
+                swap(_shards, rhs._shards);
+                _maxWordId.store(rhs._maxWordId.exchange(0));
+            }
+            ConcurrentWordMap& operator = (const ConcurrentWordMap& rhs) {
+                if (this == &rhs) return *this;
+                ConcurrentWordMap tmp(rhs);
+                swap(_shards, tmp._shards);
+                _maxWordId.store(tmp._maxWordId.load());
+                return *this;
+            }
+            ConcurrentWordMap& operator = (ConcurrentWordMap&& rhs) {
+                swap(_shards, rhs._shards);
+                _maxWordId.store(rhs._maxWordId.exchange(_maxWordId.load()));
+                return *this;
+            }
+
+            // 0 if the word is unknown, never locks
+            WordIdType find(StringRef word) const {
+                auto hash = StringRefHash()(word);
+                const Table* table = _shardOf(hash).table.load(memory_order_acquire);
+                for (size_t i = hash & table->mask; ; i = (i + 1) & table->mask) {
+                    const Entry* entry = table->slots[i].load(memory_order_acquire);
+                    if (entry == nullptr) return 0;
+                    if (entry->hash == hash && entry->word == word) return entry->wordId;
+                }
+            }
+
+            // the id of word, a new one if no thread has added it yet
+            WordIdType insert(StringRef word) {
+                auto wordId = find(word);
+                if (wordId != 0) return wordId;
+                return _insert(word, StringRefHash()(word), 0);
+            }
+
+            // number of words, the largest id handed out so far
+            size_type size() const {
+                return _maxWordId.load(memory_order_acquire);
+            }
+
+            // visits every word, must not run concurrently with insert
+            template <typename Func>
+            void forEach(Func func) const {
+                for (size_t s = 0; s < _shardNum; s++) {
+                    for (const auto& entry : _shards[s].entries) {
+                        func(StringRef(entry->word), entry->wordId);
+                    }
+                }
+            }
+
+            bool operator == (const ConcurrentWordMap& rhs) const {
+                if (size() != rhs.size()) return false;
+                bool equal = true;
+                forEach([&rhs, &equal] (StringRef word, WordIdType wordId) {
+                    if (rhs.find(word) != wordId) equal = false;
+                });
+                return equal;
+            }
+            bool operator != (const ConcurrentWordMap& rhs) const {
+                return !(*this == rhs);
+            }
+
+        private:
+            Shard& _shardOf(size_t hash) const {
+                return _shards[hash >> (64 - _shardBits)];
+            }
+
+            // adds a word with a known id, used when copying or loading a dictionary
+            void _emplace(StringRef word, WordIdType wordId) {
+                _insert(word, StringRefHash()(word), wordId);
+                auto maxWordId = _maxWordId.load();
+                while (maxWordId < wordId && !_maxWordId.compare_exchange_weak(maxWordId, wordId)) {}
+            }
+
+            WordIdType _insert(StringRef word, size_t hash, WordIdType wordId) {
+                Shard& shard = _shardOf(hash);
+                lock_guard<mutex> guard(shard.lock);
+
+                Table* table = shard.table.load(memory_order_relaxed);
+                size_t i = hash & table->mask;
+                for (; ; i = (i + 1) & table->mask) {
+                    Entry* entry = table->slots[i].load(memory_order_relaxed);
+                    if (entry == nullptr) break;
+                    if (entry->hash == hash && entry->word == word) return entry->wordId;
+                }
+
+                if (wordId == 0) wordId = _nextWordId();
+                shard.entries.push_back(unique_ptr<Entry>(new Entry(word, wordId, hash)));
+                Entry* entry = shard.entries.back().get();
+
+                // keep the load factor at or below one half
+                if (2 * shard.entries.size() > table->mask + 1) {
+                    table = _grow(shard, table);
+                    for (i = hash & table->mask; table->slots[i].load(memory_order_relaxed) != nullptr; i = (i + 1) & table->mask) {}
+                }
+                table->slots[i].store(entry, memory_order_release);
+                return wordId;
+            }
+
+            // a new id, checked before it is handed out so the ids never wrap around
+            WordIdType _nextWordId() {
+                auto maxWordId = _maxWordId.load(memory_order_acquire);
+                do {
+                    checkedId<WordIdType>(static_cast<size_t>(maxWordId) + 1, "word id");
+                } while (!_maxWordId.compare_exchange_weak(maxWordId, maxWordId + 1, memory_order_acq_rel));
+                return maxWordId + 1;
+            }
+
+            Table* _grow(Shard& shard, const Table* table) {
+                unique_ptr<Table> bigger(new Table(2 * (table->mask + 1)));
+                for (size_t s = 0; s <= table->mask; s++) {
+                    Entry* entry = table->slots[s].load(memory_order_relaxed);
+                    if (entry == nullptr) continue;
+                    size_t i = entry->hash & bigger->mask;
+                    while (bigger->slots[i].load(memory_order_relaxed) != nullptr) i = (i + 1) & bigger->mask;
+                    bigger->slots[i].store(entry, memory_order_relaxed);
+                }
+                shard.tables.push_back(move(bigger));
+                shard.table.store(shard.tables.back().get(), memory_order_release);
+                return shard.tables.back().get();
+            }
+    };
+
+    template <>
+    struct WordMapOps<ConcurrentWordMap> {
+        static WordIdType find(const ConcurrentWordMap& wordMap, StringRef word) {
+            return wordMap.find(word);
+        }
+
+        static WordIdType insert(ConcurrentWordMap& wordMap, StringRef word) {
+            return wordMap.insert(word);
+        }
+
+        template <typename Func>
+        static void forEach(const ConcurrentWordMap& wordMap, Func func) {
+            wordMap.forEach(func);
+        }
+    };
+
+    template <>
+    struct SerializeFunc<ConcurrentWordMap> {
+        void operator () (ByteSink& fout, const ConcurrentWordMap& wordMap) const {
+            SerializeFunc<ConcurrentWordMap::size_type>()(fout, wordMap.size());
+            wordMap.forEach([&fout] (StringRef word, WordIdType wordId) {
+                SerializeFunc<string>()(fout, word.str());
+                SerializeFunc<WordIdType>()(fout, wordId);
+            });
+        }
+    };
+
+    template <>
+    struct DeserializeFunc<ConcurrentWordMap> {
+        void operator () (ByteSource& fin, ConcurrentWordMap& wordMap) const {
+            ConcurrentWordMap::size_type size;
+            DeserializeFunc<ConcurrentWordMap::size_type>()(fin, size);
+
+            wordMap = ConcurrentWordMap();
+            pair<string, WordIdType> val;
+            for (ConcurrentWordMap::size_type i = 0; i < size; i++) {
+                DeserializeFunc<pair<string, WordIdType>>()(fin, val);
+                wordMap._emplace(val.first, val.second);
+            }
+        }
+    };
+
+    // a tokenizer whose tokenize can be called from many threads at once
+    using ConcurrentTokenizer = TokenizerT<int, ConcurrentWordMap>;
+}
+
+#endif
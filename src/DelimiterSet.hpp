@@ -0,0 +1,96 @@
+#ifndef __DELIMITERSET_HPP__
+#define __DELIMITERSET_HPP__
+
+#include <string>
+#include <cstdint>
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+#include "darwin.hpp"
+
+namespace Darwin {
+    // a delimiter set compiled into a 256 entry class table. scanning compares 32 (AVX2)
+    // or 16 (SSE2) bytes at a time against every delimiter and walks the resulting bit
+    // mask, the table handles the tail, big delimiter sets and builds without SIMD
+    class DelimiterSet {
+        private:
+            static const size_t _maxSimdDelims = 8;
+
+            bool _table[256];
+            string _chars;
+
+        public:
+            explicit DelimiterSet(const string& delims = " ") {
+                for (size_t i = 0; i < 256; i++) _table[i] = false;
+                for (auto c : delims) {
+                    auto& isDelim = _table[static_cast<unsigned char>(c)];
+                    if (!isDelim) _chars.push_back(c);
+                    isDelim = true;
+                }
+            }
+
+            bool contains(char c) const {
+                return _table[static_cast<unsigned char>(c)];
+            }
+
+            // calls func(begin, end) for every non-empty run of non-delimiters in data
+            template <typename Func>
+            void forEachToken(const char* data, size_t length, Func func) const {
+                size_t pos = 0, lastPos = 0;
+                bool simd = _chars.size() <= _maxSimdDelims;
+
+#if defined(__AVX2__)
+                if (simd) {
+                    __m256i delims[_maxSimdDelims];
+                    for (size_t i = 0; i < _chars.size(); i++) delims[i] = _mm256_set1_epi8(_chars[i]);
+                    for (; pos + 32 <= length; pos += 32) {
+                        __m256i block = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + pos));
+                        __m256i hit = _mm256_setzero_si256();
+                        for (size_t i = 0; i < _chars.size(); i++) {
+                            hit = _mm256_or_si256(hit, _mm256_cmpeq_epi8(block, delims[i]));
+                        }
+                        _emit(static_cast<uint32_t>(_mm256_movemask_epi8(hit)), pos, lastPos, func);
+                    }
+                }
+#endif
+#if defined(__SSE2__)
+                if (simd) {
+                    __m128i delims[_maxSimdDelims];
+                    for (size_t i = 0; i < _chars.size(); i++) delims[i] = _mm_set1_epi8(_chars[i]);
+                    for (; pos + 16 <= length; pos += 16) {
+                        __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + pos));
+                        __m128i hit = _mm_setzero_si128();
+                        for (size_t i = 0; i < _chars.size(); i++) {
+                            hit = _mm_or_si128(hit, _mm_cmpeq_epi8(block, delims[i]));
+                        }
+                        _emit(static_cast<uint32_t>(_mm_movemask_epi8(hit)), pos, lastPos, func);
+                    }
+                }
+#endif
+                (void)simd;
+
+                for (; pos < length; pos++) {
+                    if (!contains(data[pos])) continue;
+                    if (pos != lastPos) func(lastPos, pos);
+                    lastPos = pos + 1;
+                }
+                if (length > lastPos) func(lastPos, length);
+            }
+
+        private:
+            // mask has a bit set for every delimiter in the block starting at base
+            template <typename Func>
+            static void _emit(uint32_t mask, size_t base, size_t& lastPos, Func& func) {
+                while (mask != 0) {
+                    size_t pos = base + __builtin_ctz(mask);
+                    if (pos != lastPos) func(lastPos, pos);
+                    lastPos = pos + 1;
+                    mask &= mask - 1;
+                }
+            }
+    };
+}
+
+#endif
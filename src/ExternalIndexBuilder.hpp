@@ -0,0 +1,280 @@
+#ifndef __EXTERNALINDEXBUILDER_HPP__
+#define __EXTERNALINDEXBUILDER_HPP__
+
+#include <string>
+#include <vector>
+#include <queue>
+#include <memory>
+#include <fstream>
+#include <exception>
+#include <cstdio>
+#include "darwin.hpp"
+#include "ByteStream.hpp"
+#include "Serializer.hpp"
+#include "Tokenizer.hpp"
+#include "PostingList.hpp"
+#include "LineOffsetTable.hpp"
+#include "IndexBuilder.hpp"
+
+namespace Darwin {
+    class ExternalIndexBuilderError : public exception {
+        private:
+            string _message;
+        public:
+            ExternalIndexBuilderError(const string& message) : _message(message) {}
+            virtual const char* what() const noexcept override {
+                return _message.c_str();
+            }
+    };
+
+    // builds an index that does not fit in memory straight into a Serializer dump of an
+    // IndexBuilder, which LazyIndex opens or Serializer loads. documents are indexed in
+    // memory until the postings reach memoryBudget, then the partial index is written
+    // to a run sorted by word id. the runs are k-way merged, fanIn at a time so the open
+    // files and their buffers stay bounded, in as many passes as it takes, a word at a
+    // time. documents never straddle runs, so the lists of a word are concatenated in
+    // run order and the dump is the one IndexBuilder::build would give. the line tables
+    // are spooled to files as well. memoryBudget only bounds the postings, the tokenizer
+    // and the document names are kept whole, so the vocabulary and the manifest have to
+    // fit in memory on top of it
+    class ExternalIndexBuilder {
+        private:
+            // read buffer of every run, the merge reads all of them at once
+            static const size_t _runBufferSize = 64 << 10;
+
+            // reads the lists of a run in word id order. a run is a file of list headers and
+            // one of their postings, so a merge can write a list before its header is known
+            class RunReader {
+                private:
+                    FileSource _headers;
+                    FileSource _postings;
+
+                public:
+                    PostingListHeader header;
+                    vector<unsigned char> data;
+
+                    explicit RunReader(const string& runName) :
+                        _headers(runName, _runBufferSize), _postings(runName + ".data", _runBufferSize) {
+                        if (!_headers.is_open() || !_postings.is_open()) throw ExternalIndexBuilderError("cannot open run " + runName);
+                    }
+
+                    // false at the end of the run
+                    bool next() {
+                        if (!_headers.read(reinterpret_cast<char*>(&header), sizeof(header))) return false;
+                        data.resize(header.bytes);
+                        if (!_postings.read(reinterpret_cast<char*>(data.data()), data.size())) {
+                            throw ExternalIndexBuilderError("truncated run file");
+                        }
+                        return true;
+                    }
+            };
+
+            Tokenizer _tokenizer;
+            size_t _memoryBudget;
+            size_t _fanIn;
+            size_t _runNum = 0;
+
+        public:
+            explicit ExternalIndexBuilder(const Tokenizer& tokenizer, size_t memoryBudget = 256 << 20, size_t fanIn = 32) :
+                _tokenizer(tokenizer), _memoryBudget(memoryBudget), _fanIn(max<size_t>(fanIn, 2)) {}
+
+            const Tokenizer& tokenizer() const { return _tokenizer; }
+            size_t memoryBudget() const { return _memoryBudget; }
+            // the most runs merged at once
+            size_t fanIn() const { return _fanIn; }
+            // the runs written by the last build
+            size_t runNum() const { return _runNum; }
+
+            // indexes every document listed in documents, in the format IndexBuilder::build
+            // reads, into fileName. temporary files are fileName with a suffix
+            void build(const string& documents, const string& fileName) {
+                string dataDirectory = documentDirectory(documents);
+                DocumentListType docList = readDocumentList(documents);
+                if (!docList.empty()) checkedId<DocIdType>(docList.size() - 1, "doc id");
+
+                const string linesName = fileName + ".lines";
+                const string lengthsName = fileName + ".lengths";
+                vector<string> runNames;
+                {
+                    FileSink lines(linesName);
+                    FileSink lengths(lengthsName);
+                    InvertedIndexType partial;
+                    size_t bytes = 0;
+                    for (size_t i = 0; i < docList.size(); i++) {
+                        LineOffsetTable lineOffsets;
+                        vector<PositionType> lineLengths;
+                        bytes += IndexBuilder::indexDocument(i, dataDirectory + docList[i], _tokenizer, partial,
+                                                             lineOffsets, lineLengths);
+                        SerializeFunc<LineOffsetTable>()(lines, lineOffsets);
+                        SerializeFunc<vector<PositionType>>()(lengths, lineLengths);
+
+                        if (bytes >= _memoryBudget) {
+                            runNames.push_back(fileName + ".run" + to_string(runNames.size()));
+                            _writeRun(runNames.back(), partial);
+                            partial.clear();
+                            bytes = 0;
+                        }
+                    }
+                    if (!partial.empty()) {
+                        runNames.push_back(fileName + ".run" + to_string(runNames.size()));
+                        _writeRun(runNames.back(), partial);
+                    }
+                    _close(lines, linesName);
+                    _close(lengths, lengthsName);
+                }
+                _runNum = runNames.size();
+
+                for (size_t pass = 0; runNames.size() > _fanIn; pass++) {
+                    vector<string> merged;
+                    for (size_t first = 0; first < runNames.size(); first += _fanIn) {
+                        vector<string> group(runNames.begin() + first, runNames.begin() + min(first + _fanIn, runNames.size()));
+                        merged.push_back(fileName + ".pass" + to_string(pass) + "." + to_string(merged.size()));
+                        _merge(group, merged.back());
+                        for (const auto& runName : group) _removeRun(runName);
+                    }
+                    runNames = merged;
+                }
+                const string listsName = fileName + ".lists";
+                size_t listNum = _merge(runNames, listsName);
+                for (const auto& runName : runNames) _removeRun(runName);
+
+                // the spooled sections are vectors, written as a size and their elements
+                FileSink fout(fileName);
+                writeIndexDump(fout, _tokenizer, dataDirectory, docList,
+                    [&] (ByteSink& sink) {
+                        SerializeFunc<size_t>()(sink, docList.size());
+                        _copy(sink, linesName);
+                    },
+                    [&] (ByteSink& sink) {
+                        // the headers, then the postings
+                        SerializeFunc<size_t>()(sink, listNum);
+                        _copy(sink, listsName);
+                        _copy(sink, listsName + ".data");
+                    },
+                    [&] (ByteSink& sink) {
+                        SerializeFunc<size_t>()(sink, docList.size());
+                        _copy(sink, lengthsName);
+                    },
+                    nullptr, nullptr);
+                _close(fout, fileName);
+
+                remove(linesName.c_str());
+                remove(lengthsName.c_str());
+                _removeRun(listsName);
+            }
+
+        private:
+            // the lists of partial sorted by word id, their headers and their encoded postings
+            void _writeRun(const string& runName, const InvertedIndexType& partial) {
+                vector<const InvertedIndexType::value_type*> lists;
+                lists.reserve(partial.size());
+                for (const auto& i : partial) lists.push_back(&i);
+                sort(lists.begin(), lists.end(), [] (const InvertedIndexType::value_type* lhs,
+                                                     const InvertedIndexType::value_type* rhs) {
+                    return lhs->first < rhs->first;
+                });
+
+                FileSink headers(runName);
+                FileSink postings(runName + ".data");
+                for (const auto list : lists) {
+                    PostingListHeader header = {list->second.size(), list->second.bytes(), list->second.maxTf(),
+                                                list->second.last(), list->first};
+                    headers.write(reinterpret_cast<const char*>(&header), sizeof(header));
+                    postings.write(reinterpret_cast<const char*>(list->second.data()), list->second.bytes());
+                }
+                _close(headers, runName);
+                _close(postings, runName + ".data");
+            }
+
+            // merges runNames, consecutive runs in document order, into the run runName
+            // and returns its number of lists
+            size_t _merge(const vector<string>& runNames, const string& runName) {
+                vector<unique_ptr<RunReader>> runs;
+                // the smallest word id first, of equal ones the earliest run
+                auto later = [&runs] (size_t lhs, size_t rhs) {
+                    if (runs[lhs]->header.wordId != runs[rhs]->header.wordId) {
+                        return runs[lhs]->header.wordId > runs[rhs]->header.wordId;
+                    }
+                    return lhs > rhs;
+                };
+                priority_queue<size_t, vector<size_t>, decltype(later)> heads(later);
+                for (size_t r = 0; r < runNames.size(); r++) {
+                    runs.emplace_back(new RunReader(runNames[r]));
+                    if (runs[r]->next()) heads.push(r);
+                }
+
+                FileSink headers(runName);
+                FileSink postings(runName + ".data");
+                PostingListHeader merged;
+                size_t listNum = 0;
+                vector<unsigned char> first;
+                while (!heads.empty()) {
+                    size_t r = heads.top();
+                    heads.pop();
+                    const auto& header = runs[r]->header;
+                    const auto& data = runs[r]->data;
+
+                    if (listNum == 0 || merged.wordId != header.wordId) {
+                        if (listNum > 0) headers.write(reinterpret_cast<const char*>(&merged), sizeof(merged));
+                        merged = header;
+                        listNum += 1;
+                        postings.write(reinterpret_cast<const char*>(data.data()), data.size());
+                    } else {
+                        // the first posting of a list is relative to the all zero one,
+                        // re-encode it relative to the last posting of the word so far
+                        const unsigned char* pos = data.data();
+                        InvertedIndexValueType posting;
+                        posting.docId = VarByte::decode(pos);
+                        posting.lineno = VarByte::decode(pos);
+                        posting.tf = VarByte::decode(pos);
+
+                        first.clear();
+                        VarByte::encode(first, posting.docId - merged.last.docId);
+                        VarByte::encode(first, posting.lineno);
+                        VarByte::encode(first, posting.tf);
+                        postings.write(reinterpret_cast<const char*>(first.data()), first.size());
+                        postings.write(reinterpret_cast<const char*>(pos), data.data() + data.size() - pos);
+
+                        merged.size += header.size;
+                        merged.bytes += first.size() + (data.data() + data.size() - pos);
+                        merged.maxTf = max(merged.maxTf, header.maxTf);
+                        merged.last = header.last;
+                    }
+                    if (runs[r]->next()) heads.push(r);
+                }
+                if (listNum > 0) headers.write(reinterpret_cast<const char*>(&merged), sizeof(merged));
+                _close(headers, runName);
+                _close(postings, runName + ".data");
+                return listNum;
+            }
+
+            static void _removeRun(const string& runName) {
+                remove(runName.c_str());
+                remove((runName + ".data").c_str());
+            }
+
+            void _copy(ByteSink& fout, const string& fileName) const {
+                FileSource source(fileName);
+                if (!source.is_open()) throw ExternalIndexBuilderError("cannot read " + fileName);
+                vector<char> buffer(_runBufferSize);
+                size_t size = _fileSize(fileName);
+                for (size_t copied = 0; copied < size; copied += buffer.size()) {
+                    size_t length = min(buffer.size(), size - copied);
+                    if (!source.read(buffer.data(), length)) throw ExternalIndexBuilderError("cannot read " + fileName);
+                    fout.write(buffer.data(), length);
+                }
+            }
+
+            static size_t _fileSize(const string& fileName) {
+                ifstream fin(fileName, ios_base::in | ios_base::binary | ios_base::ate);
+                return static_cast<size_t>(fin.tellg());
+            }
+
+            void _close(FileSink& fout, const string& fileName) const {
+                fout.close();
+                if (!fout.good()) throw ExternalIndexBuilderError("cannot write " + fileName);
+            }
+    };
+}
+
+#endif
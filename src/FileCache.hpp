@@ -0,0 +1,122 @@
+#ifndef __FILECACHE_HPP__
+#define __FILECACHE_HPP__
+
+#include <string>
+#include <vector>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <algorithm>
+#include <cstring>
+#include <cerrno>
+#include <fcntl.h>
+#include <unistd.h>
+#include "darwin.hpp"
+
+namespace Darwin {
+    // LRU cache of open document descriptors. lines are fetched with pread, which
+    // leaves the file position alone, so one descriptor serves every thread at once.
+    // an evicted descriptor is only closed after the last reader has dropped it
+    class FileCache {
+        private:
+            struct File {
+                int fd;
+                explicit File(int fd) : fd(fd) {}
+                ~File() { ::close(fd); }
+            };
+            using FilePtr = shared_ptr<File>;
+            using LruType = list<pair<string, FilePtr>>;
+
+            static const size_t _chunkSize = 4096;
+
+            size_t _capacity;
+            mutable mutex _lock;
+            LruType _lru;
+            unordered_map<string, LruType::iterator> _files;
+
+        public:
+            explicit FileCache(size_t capacity = 64) : _capacity(capacity) {}
+            // a copy starts out empty, descriptors are never shared between caches
+            FileCache(const FileCache& rhs) : _capacity(rhs._capacity) {}
+            FileCache& operator = (const FileCache& rhs) {
+                if (this == &rhs) return *this;
+                lock_guard<mutex> guard(_lock);
+                _capacity = rhs._capacity;
+                _lru.clear();
+                _files.clear();
+                return *this;
+            }
+
+            size_t size() const {
+                lock_guard<mutex> guard(_lock);
+                return _lru.size();
+            }
+
+            // the line starting at offset in fileName without the '\n',
+            // empty if the file cannot be read
+            string readLine(const string& fileName, size_t offset) {
+                FilePtr file = _open(fileName);
+                if (!file) return string();
+
+                // grows to the longest line seen by this thread and is reused, but every read
+                // is one chunk so a short line costs one chunk however long the buffer got
+                static thread_local vector<char> buffer(_chunkSize);
+                size_t length = 0;
+                while (true) {
+                    if (buffer.size() - length < _chunkSize) buffer.resize(max(2 * buffer.size(), length + _chunkSize));
+                    ssize_t n = pread(file->fd, buffer.data() + length, _chunkSize, offset + length);
+                    if (n < 0 && errno == EINTR) continue;
+                    if (n <= 0) break;
+
+                    const char* newline = static_cast<const char*>(memchr(buffer.data() + length, '\n', n));
+                    if (newline != nullptr) return string(buffer.data(), newline - buffer.data());
+                    length += n;
+                }
+                return string(buffer.data(), length);
+            }
+
+            // drops the descriptor of fileName, the next read opens the file again. called
+            // when a file may have been replaced, e.g. renamed over, since a descriptor
+            // keeps reading the old file. readers still holding it finish on the old one
+            void invalidate(const string& fileName) {
+                lock_guard<mutex> guard(_lock);
+                auto file = _files.find(fileName);
+                if (file == _files.end()) return;
+                _lru.erase(file->second);
+                _files.erase(file);
+            }
+
+        private:
+            FilePtr _open(const string& fileName) {
+                {
+                    lock_guard<mutex> guard(_lock);
+                    auto file = _files.find(fileName);
+                    if (file != _files.end()) {
+                        _lru.splice(_lru.begin(), _lru, file->second);
+                        return file->second->second;
+                    }
+                }
+
+                // open outside the lock, a thread that lost the race drops its descriptor
+                int fd = ::open(fileName.c_str(), O_RDONLY);
+                if (fd < 0) return FilePtr();
+                FilePtr opened = make_shared<File>(fd);
+
+                lock_guard<mutex> guard(_lock);
+                auto file = _files.find(fileName);
+                if (file != _files.end()) return file->second->second;
+                if (_capacity == 0) return opened;
+
+                _lru.push_front(make_pair(fileName, opened));
+                _files[fileName] = _lru.begin();
+                if (_lru.size() > _capacity) {
+                    _files.erase(_lru.back().first);
+                    _lru.pop_back();
+                }
+                return opened;
+            }
+    };
+}
+
+#endif
@@ -0,0 +1,166 @@
+#ifndef __FROZENINDEX_HPP__
+#define __FROZENINDEX_HPP__
+
+#include <string>
+#include <vector>
+#include <algorithm>
+#include "darwin.hpp"
+#include "PostingList.hpp"
+#include "LineOffsetTable.hpp"
+#include "FileCache.hpp"
+#include "Ranking.hpp"
+#include "LineSearch.hpp"
+#include "IndexBuilder.hpp"
+
+namespace Darwin {
+    // read-only index compacted out of a built IndexBuilder, see IndexBuilderT::freeze.
+    // the words are one string pool in byte order found by binary search and the
+    // postings one buffer in the same order, so there are no hash buckets, nodes or
+    // per word allocations left and the index takes little more than its postings
+    class FrozenIndex : public LineSearch<FrozenIndex, PostingListRef> {
+        friend LineSearch<FrozenIndex, PostingListRef>;
+
+        private:
+            string _dataDirectory;
+            // word i is [_wordOffsets[i], _wordOffsets[i + 1]) of _words
+            string _words;
+            vector<size_t> _wordOffsets;
+            // the postings of word i are [_postingOffsets[i], _postingOffsets[i + 1]) of _postings
+            vector<unsigned char> _postings;
+            vector<size_t> _postingOffsets;
+            vector<size_t> _postingNums;
+            vector<PositionType> _maxTfs;
+            // document d is [_documentOffsets[d], _documentOffsets[d + 1]) of _documents
+            string _documents;
+            vector<size_t> _documentOffsets;
+            LineOffsetListType _lineOffsets;
+            // the line lengths of document d start at _lineLengthOffsets[d]
+            vector<PositionType> _lineLengths;
+            vector<size_t> _lineLengthOffsets;
+            LineStatistics _lineStatistics;
+            mutable FileCache _fileCache;
+
+        public:
+            template <typename Validator>
+            explicit FrozenIndex(const IndexBuilderT<Validator>& indexBuilder) :
+                _dataDirectory(indexBuilder.dataDirectory()), _lineOffsets(indexBuilder.lineOffsets()) {
+                const auto& index = indexBuilder.index();
+                vector<pair<StringRef, const PostingList*>> terms;
+                terms.reserve(index.size());
+                indexBuilder.tokenizer().forEachWord([&terms, &index] (StringRef word, WordIdType wordId) {
+                    auto postings = index.find(wordId);
+                    if (postings != index.end()) terms.push_back(make_pair(word, &postings->second));
+                });
+                sort(terms.begin(), terms.end(), [] (const pair<StringRef, const PostingList*>& lhs,
+                                                     const pair<StringRef, const PostingList*>& rhs) {
+                    return lhs.first.compare(rhs.first) < 0;
+                });
+
+                size_t wordBytes = 0;
+                size_t postingBytes = 0;
+                for (const auto& term : terms) {
+                    wordBytes += term.first.length();
+                    postingBytes += term.second->bytes();
+                }
+                _words.reserve(wordBytes);
+                _postings.reserve(postingBytes);
+                _wordOffsets.reserve(terms.size() + 1);
+                _postingOffsets.reserve(terms.size() + 1);
+                _postingNums.reserve(terms.size());
+                _maxTfs.reserve(terms.size());
+                for (const auto& term : terms) {
+                    _wordOffsets.push_back(_words.length());
+                    _words.append(term.first.data(), term.first.length());
+                    _postingOffsets.push_back(_postings.size());
+                    _postings.insert(_postings.end(), term.second->data(), term.second->data() + term.second->bytes());
+                    _postingNums.push_back(term.second->size());
+                    _maxTfs.push_back(term.second->maxTf());
+                }
+                _wordOffsets.push_back(_words.length());
+                _postingOffsets.push_back(_postings.size());
+
+                for (const auto& doc : indexBuilder.documents()) {
+                    _documentOffsets.push_back(_documents.length());
+                    _documents += doc;
+                }
+                _documentOffsets.push_back(_documents.length());
+
+                for (const auto& doc : indexBuilder.lineLengths()) {
+                    _lineLengthOffsets.push_back(_lineLengths.size());
+                    _lineLengths.insert(_lineLengths.end(), doc.begin(), doc.end());
+                    for (auto length : doc) _lineStatistics.add(length);
+                }
+                _lineLengthOffsets.push_back(_lineLengths.size());
+            }
+
+            size_t documentNum() const { return _documentOffsets.size() - 1; }
+            size_t termNum() const { return _wordOffsets.size() - 1; }
+            const string& dataDirectory() const { return _dataDirectory; }
+
+            StringRef documentName(DocIdType docId) const {
+                return StringRef(_documents.data() + _documentOffsets[docId], _documentOffsets[docId + 1] - _documentOffsets[docId]);
+            }
+
+            // bytes held by the index, not counting the file cache
+            size_t bytes() const {
+                size_t ret = _words.capacity() + _postings.capacity() + _documents.capacity() + _dataDirectory.capacity();
+                ret += (_wordOffsets.capacity() + _postingOffsets.capacity() + _postingNums.capacity() +
+                        _documentOffsets.capacity() + _lineLengthOffsets.capacity()) * sizeof(size_t);
+                ret += _maxTfs.capacity() * sizeof(PositionType) + _lineLengths.capacity() * sizeof(PositionType);
+                for (const auto& table : _lineOffsets) {
+                    ret += sizeof(table) + table.samples().capacity() * sizeof(uint64_t) + table.data().capacity();
+                }
+                return ret;
+            }
+
+            // empty if the word is unknown
+            PostingListRef postings(StringRef word) const {
+                size_t term = _find(word);
+                if (term == termNum()) return PostingListRef();
+                return _postingsOf(term);
+            }
+
+            // the k lines with the best BM25 score for any of the words of query, best first
+            RankedResultType searchTopK(const string& query, size_t k, const BM25& bm25 = BM25()) const {
+                auto lookup = [this] (StringRef word, PostingListRef& postings, size_t& maxTf) {
+                    size_t term = _find(word);
+                    if (term == termNum()) return false;
+                    postings = _postingsOf(term);
+                    maxTf = _maxTfs[term];
+                    return true;
+                };
+                auto lineLength = [this] (DocIdType docId, size_t lineno) {
+                    return _lineLengths[_lineLengthOffsets[docId] + lineno];
+                };
+                return _topK(query, k, bm25, _lineStatistics, lookup, lineLength);
+            }
+
+        private:
+            // the index of word in the term arrays, termNum() if it is unknown
+            size_t _find(StringRef word) const {
+                return findSorted(termNum(), word, [this] (size_t term) { return _word(term); });
+            }
+
+            StringRef _word(size_t term) const {
+                return StringRef(_words.data() + _wordOffsets[term], _wordOffsets[term + 1] - _wordOffsets[term]);
+            }
+
+            PostingListRef _postingsOf(size_t term) const {
+                return PostingListRef(_postings.data() + _postingOffsets[term],
+                                      _postingOffsets[term + 1] - _postingOffsets[term], _postingNums[term]);
+            }
+
+            Result _result(const InvertedIndexValueType& doc) const {
+                string docName = documentName(doc.docId).str();
+                string lineContent = _fileCache.readLine(_dataDirectory + docName, _lineOffsets[doc.docId][doc.lineno]);
+                return Result(doc.docId, docName, doc.lineno, lineContent);
+            }
+    };
+
+    template <typename Validator>
+    FrozenIndex IndexBuilderT<Validator>::freeze() const {
+        return FrozenIndex(*this);
+    }
+}
+
+#endif
@@ -3,99 +3,93 @@
 
 #include <string>
 #include <fstream>
+#include <thread>
+#include <regex>
+#include <functional>
 #include "darwin.hpp"
 #include "Tokenizer.hpp"
 #include "Serializer.hpp"
-#include <unordered_set>
+#include "PostingList.hpp"
+#include "LineOffsetTable.hpp"
+#include "LineReader.hpp"
+#include "FileCache.hpp"
+#include "Query.hpp"
+#include "Ranking.hpp"
+#include "SearchCursor.hpp"
+#include "LineSearch.hpp"
+#include "TrigramIndex.hpp"
+#include "TermDictionary.hpp"
+#include "PositionIndex.hpp"
 
 namespace Darwin {
-    struct InvertedIndexValueType {
-        DocIdType docId;
-        size_t offset;
-        size_t lineno;
-        InvertedIndexValueType(DocIdType docId, size_t offset, size_t lineno) :
-            docId(docId), offset(offset), lineno(lineno) {}
-        InvertedIndexValueType(const InvertedIndexValueType& obj) : 
-            docId(obj.docId), offset(obj.offset), lineno(obj.lineno) {}
-        InvertedIndexValueType() :
-            docId(0), offset(0), lineno(0) {}
-        bool operator == (const InvertedIndexValueType& rhs) const {
-            if (rhs.docId != docId) return false;
-            if (rhs.offset != offset) return false;
-            if (rhs.lineno != lineno) return false;
-            return true;
-        }
-    };
-
-    template <>
-    struct SerializeFunc<InvertedIndexValueType> {
-        void operator () (ofstream& fout, const InvertedIndexValueType& v) const {
-            SerializeFunc<DocIdType>()(fout, v.docId);
-            SerializeFunc<size_t>()(fout, v.offset);
-            SerializeFunc<size_t>()(fout, v.lineno);
-        }
+    class FrozenIndex;
+
+    using InvertedIndexType = unordered_map<WordIdType, PostingList>;
+
+    // the index is written as a directory of posting list headers sorted by word id,
+    // followed by the encoded postings in the same order. a reader can keep just the
+    // directory and fetch a list on demand, see LazyIndex
+    // the narrow fields come last so there is no padding with either id width
+    struct PostingListHeader {
+        size_t size;
+        size_t bytes;
+        size_t maxTf;
+        InvertedIndexValueType last;
+        WordIdType wordId;
     };
 
     template <>
-    struct DeserializeFunc<InvertedIndexValueType> {
-        void operator () (ifstream& fin, InvertedIndexValueType& v) const {
-            DeserializeFunc<DocIdType>()(fin, v.docId);
-            DeserializeFunc<size_t>()(fin, v.offset);
-            DeserializeFunc<size_t>()(fin, v.lineno);
-        }
-    };
-
-    struct HashFunc {
-        size_t operator() (const InvertedIndexValueType &val) const {
-            std::hash<size_t> hasher;
-            size_t ret = val.docId;
-            ret ^= hasher(val.offset) + 0x9e3779b9 + (ret << 6) + (ret >> 2);
-            ret ^= hasher(val.lineno) + 0x9e3779b9 + (ret << 6) + (ret >> 2);
-            return ret;
-        }
-    };
-
-    using InvertedIndexType = unordered_map<WordIdType, unordered_set<InvertedIndexValueType, HashFunc>>;
+    struct IsBulkSerializable<PostingListHeader> : integral_constant<bool,
+        IsBulkSerializable<InvertedIndexValueType>::value &&
+        sizeof(PostingListHeader) == sizeof(WordIdType) + 3 * sizeof(size_t) + sizeof(InvertedIndexValueType)> {};
+    static_assert(IsBulkSerializable<PostingListHeader>::value, "the posting list directory is written as one block");
 
     template <> 
     struct SerializeFunc<InvertedIndexType> {
-        void operator () (ofstream& fout, const InvertedIndexType& index) const {
-            using size_type = typename InvertedIndexType::size_type;
-            using value_type = typename InvertedIndexType::value_type;
-
-            SerializeFunc<size_type>()(fout, index.size());
-            for (const auto & i : index) {
-                SerializeFunc<value_type>()(fout, i);
+        void operator () (ByteSink& fout, const InvertedIndexType& index) const {
+            vector<const InvertedIndexType::value_type*> lists;
+            lists.reserve(index.size());
+            for (const auto& i : index) lists.push_back(&i);
+            sort(lists.begin(), lists.end(), [] (const InvertedIndexType::value_type* lhs, const InvertedIndexType::value_type* rhs) {
+                return lhs->first < rhs->first;
+            });
+
+            vector<PostingListHeader> directory;
+            directory.reserve(lists.size());
+            for (const auto list : lists) {
+                directory.push_back({list->second.size(), list->second.bytes(), list->second.maxTf(), list->second.last(), list->first});
+            }
+            SerializeFunc<vector<PostingListHeader>>()(fout, directory);
+            for (const auto list : lists) {
+                SerializeFunc<const unsigned char*>()(fout, list->second.data(), list->second.bytes());
             }
         }
     };
 
     template <> 
     struct DeserializeFunc<InvertedIndexType> {
-        void operator () (ifstream& fin, InvertedIndexType& index) const {
-            using size_type = typename InvertedIndexType::size_type;
-            using key_type = typename InvertedIndexType::key_type;
-            using mapped_type = typename InvertedIndexType::mapped_type;
-
-            size_type size;
-            DeserializeFunc<size_type>()(fin, size);
+        void operator () (ByteSource& fin, InvertedIndexType& index) const {
+            vector<PostingListHeader> directory;
+            DeserializeFunc<vector<PostingListHeader>>()(fin, directory);
 
             index.clear();
-            index.reserve(size);
-
-            pair<key_type, mapped_type> val;
-            for (size_type i = 0; i < size; i++) {
-                DeserializeFunc<pair<key_type, mapped_type>>()(fin, val);
-                index.insert(val);
+            index.reserve(directory.size());
+            for (const auto& header : directory) {
+                vector<unsigned char> data(header.bytes);
+                DeserializeFunc<unsigned char*>()(fin, data.data(), data.size());
+                index.emplace(header.wordId, PostingList(move(data), header.size, header.last, header.maxTf));
             }
         }
     };
 
     using DocumentListType = vector<string>;
+    // number of words of every line of every document
+    using LineLengthListType = vector<vector<PositionType>>;
+    using LineOffsetListType = vector<LineOffsetTable>;
 
     template <> 
     struct SerializeFunc<DocumentListType> {
-        void operator () (ofstream& fout, const DocumentListType& docList) const {
+        void operator () (ByteSink& fout, const DocumentListType& docList) const {
             using size_type = typename DocumentListType::size_type;
             using value_type= typename DocumentListType::value_type;
 
@@ -108,7 +102,7 @@ namespace Darwin {
 
     template <>
     struct DeserializeFunc<DocumentListType> {
-        void operator () (ifstream& fin, DocumentListType& docList) const {
+        void operator () (ByteSource& fin, DocumentListType& docList) const {
             using size_type = typename DocumentListType::size_type;
             using value_type= typename DocumentListType::value_type;
 
@@ -126,6 +120,53 @@ namespace Darwin {
         }
     };
 
+    // the directory of a documents file with a trailing slash, the names it lists are
+    // relative to it
+    inline string documentDirectory(const string& documents) {
+        auto pos = documents.find_last_of("/");
+        return (pos == string::npos ? "." : documents.substr(0, pos)) + "/";
+    }
+
+    // the names listed in a documents file, a line of an id and a name per document.
+    // other lines are skipped
+    inline DocumentListType readDocumentList(const string& documents) {
+        DocumentListType docList;
+        DelimiterSet delims(" ");
+        ifstream content(documents);
+        string line;
+        while (getline(content, line)) {
+            size_t fieldNum = 0;
+            StringRef name;
+            delims.forEachToken(line.data(), line.length(), [&] (size_t begin, size_t end) {
+                if (fieldNum++ == 1) name = StringRef(line.data() + begin, end - begin);
+            });
+            if (fieldNum == 2) docList.push_back(name.str());
+        }
+        return docList;
+    }
+
+    // writes the sections of an IndexBuilder dump in the order DeserializeFunc<IndexBuilderT>
+    // reads them. the line tables and the postings are left to callbacks, so a builder can
+    // stream them from disk. a null trigrams or positions is written as not built
+    inline void writeIndexDump(ByteSink& fout, const Tokenizer& tokenizer, const string& dataDirectory,
+                               const DocumentListType& documents,
+                               const function<void(ByteSink&)>& writeLineOffsets,
+                               const function<void(ByteSink&)>& writeIndex,
+                               const function<void(ByteSink&)>& writeLineLengths,
+                               const TrigramIndex* trigrams, const PositionIndex* positions) {
+        SerializeFunc<IdWidths>()(fout, IdWidths());
+        SerializeFunc<Tokenizer>()(fout, tokenizer);
+        SerializeFunc<string>()(fout, dataDirectory);
+        SerializeFunc<DocumentListType>()(fout, documents);
+        writeLineOffsets(fout);
+        writeIndex(fout);
+        writeLineLengths(fout);
+        SerializeFunc<bool>()(fout, trigrams != nullptr);
+        SerializeFunc<TrigramIndex>()(fout, trigrams ? *trigrams : TrigramIndex());
+        SerializeFunc<bool>()(fout, positions != nullptr);
+        SerializeFunc<PositionIndex>()(fout, positions ? *positions : PositionIndex());
+    }
+
     template <typename Validator>
     class IndexBuilderT;
 
@@ -133,18 +174,34 @@ namespace Darwin {
     inline bool operator == (const IndexBuilderT<Validator>& i1, const IndexBuilderT<Validator>& i2);
 
     template <typename Validator>
-    class IndexBuilderT {
+    class IndexBuilderT : public LineSearch<IndexBuilderT<Validator>, PostingListRef> {
         friend Validator;
         friend bool operator == <> (const IndexBuilderT& i1, const IndexBuilderT& i2);
         friend SerializeFunc<IndexBuilderT>;
         friend DeserializeFunc<IndexBuilderT>;
-
+        using Search = LineSearch<IndexBuilderT, PostingListRef>;
+        friend Search;
+        using Search::_fetch;
+        using Search::_topK;
 
         private:
             DocumentListType _documents; 
             Tokenizer _tokenizer;
             InvertedIndexType _index;
             string _dataDirectory;
+            LineOffsetListType _lineOffsets;
+            LineLengthListType _lineLengths;
+            // only built on request, substring searches read every line without it
+            bool _hasTrigrams = false;
+            TrigramIndex _trigrams;
+            // only built on request, phrase and proximity searches need it
+            bool _hasPositions = false;
+            PositionIndex _positions;
+            // the words in byte order for prefix and wildcard terms, rebuilt from the tokenizer
+            TermDictionary _terms;
+            // derived from _lineLengths for ranking
+            LineStatistics _lineStatistics;
+            mutable FileCache _fileCache;
 
         public:
             explicit IndexBuilderT(const Tokenizer& tokenizer) : _tokenizer(tokenizer) {}
@@ -154,109 +211,438 @@ namespace Darwin {
                 _tokenizer = move(rhs._tokenizer);
                 _index = move(rhs._index);
                 _dataDirectory = move(rhs._dataDirectory);
+                _lineOffsets = move(rhs._lineOffsets);
+                _lineLengths = move(rhs._lineLengths);
+                _hasTrigrams = rhs._hasTrigrams;
+                _trigrams = move(rhs._trigrams);
+                _hasPositions = rhs._hasPositions;
+                _positions = move(rhs._positions);
+                _terms = move(rhs._terms);
+                _updateLineStatistics();
+                return *this;
             }
             IndexBuilderT& operator = (const IndexBuilderT& rhs) {
                 _documents = rhs._documents;
                 _tokenizer = rhs._tokenizer;
                 _index = rhs._index;
                 _dataDirectory = rhs._dataDirectory;
+                _lineOffsets = rhs._lineOffsets;
+                _lineLengths = rhs._lineLengths;
+                _hasTrigrams = rhs._hasTrigrams;
+                _trigrams = rhs._trigrams;
+                _hasPositions = rhs._hasPositions;
+                _positions = rhs._positions;
+                _terms = rhs._terms;
+                _updateLineStatistics();
+                return *this;
             }
 
             WordIdType getWordId(const string& word) const {
                 return _tokenizer.getWordId(word);
             }
 
-            void build(const string& documents) {
-                auto pos = documents.find_last_of("/");
-                _dataDirectory = (pos == string::npos ? "." : documents.substr(0, documents.find_last_of("/")));
-                _dataDirectory += "/";
-                _documents = _fillDocList(documents);
-                _index = _buildInvertedIndex(_documents); 
+            const DocumentListType& documents() const { return _documents; }
+            const Tokenizer& tokenizer() const { return _tokenizer; }
+            const InvertedIndexType& index() const { return _index; }
+            const string& dataDirectory() const { return _dataDirectory; }
+            const LineOffsetListType& lineOffsets() const { return _lineOffsets; }
+            const LineLengthListType& lineLengths() const { return _lineLengths; }
+            bool hasTrigrams() const { return _hasTrigrams; }
+            const TrigramIndex& trigrams() const { return _trigrams; }
+            bool hasPositions() const { return _hasPositions; }
+            const PositionIndex& positions() const { return _positions; }
+            const TermDictionary& terms() const { return _terms; }
+
+            // threadNum > 1 indexes the documents on that many workers,
+            // the word ids and the index are the same as for a single thread.
+            // trigrams also builds the trigram index for searchSubstring and searchRegex,
+            // positions the token positions for searchPhrase and searchNear
+            void build(const string& documents, size_t threadNum = 1, bool trigrams = false, bool positions = false) {
+                _dataDirectory = documentDirectory(documents);
+                _documents = readDocumentList(documents);
+                if (!_documents.empty()) checkedId<DocIdType>(_documents.size() - 1, "doc id");
+                _lineOffsets.assign(_documents.size(), LineOffsetTable());
+                _lineLengths.assign(_documents.size(), vector<PositionType>());
+                _hasTrigrams = trigrams;
+                _trigrams.clear();
+                _hasPositions = positions;
+                _positions.clear();
+                if (threadNum > 1) {
+                    _index = _buildInvertedIndexParallel(_documents, threadNum, trigrams ? &_trigrams : nullptr,
+                                                         positions ? &_positions : nullptr);
+                } else {
+                    _index = _buildInvertedIndex(_documents, trigrams ? &_trigrams : nullptr, positions ? &_positions : nullptr);
+                }
+                _trigrams.shrink_to_fit();
+                _positions.shrink_to_fit();
+                _terms = TermDictionary(_tokenizer);
+                _updateLineStatistics();
             }
 
-            SearchResultType search(const string& word) const {
-                string lineContent;
-                SearchResultType result;
-                WordIdType wordId = _tokenizer.getWordId(word);
-                auto docs = _index.find(wordId);
-                if (docs == _index.end()) return result;
+            // a read-only copy of the built index in flat arrays, defined in FrozenIndex.hpp.
+            // searches give the same results, the builder can be dropped afterwards
+            FrozenIndex freeze() const;
+
+            // empty if the word is unknown
+            PostingListRef postings(StringRef word) const {
+                auto docs = _index.find(_tokenizer.getWordId(word));
+                if (docs == _index.end()) return PostingListRef();
+                return docs->second.ref();
+            }
+
+            // lines with any word matching pattern, where * stands for any run of bytes and
+            // ? for a single one: conn* finds connect, connection and conn
+            SearchResultType searchWildcard(const string& pattern) const {
+                return _fetch(_unitePostings(_terms.expand(pattern)));
+            }
+
+            // lines with any word within maxDistance edits of word, at most 2
+            SearchResultType searchFuzzy(const string& word, size_t maxDistance = 1) const {
+                return _fetch(_fuzzyPostings(word, maxDistance));
+            }
+
+            // lines with the words of phrase next to each other in that order, told from the
+            // positions alone. throws InvalidQuery if the index was built without positions
+            SearchResultType searchPhrase(const string& phrase) const {
+                return _fetch(_positionalPostings(_tokenizer.split(phrase), [] (const vector<vector<PositionType>>& positions) {
+                    size_t matches = 0;
+                    for (auto first : positions[0]) {
+                        size_t i = 1;
+                        while (i < positions.size() && binary_search(positions[i].begin(), positions[i].end(), first + i)) i++;
+                        if (i == positions.size()) matches++;
+                    }
+                    return matches;
+                }));
+            }
+
+            // lines with lhs and rhs at most k words apart in either order, lhs NEAR/k rhs
+            SearchResultType searchNear(const string& lhs, const string& rhs, size_t k) const {
+                return _fetch(_positionalPostings({lhs, rhs}, [k] (const vector<vector<PositionType>>& positions) {
+                    size_t matches = 0;
+                    for (auto p : positions[0]) {
+                        auto q = lower_bound(positions[1].begin(), positions[1].end(), p > k ? p - k : 0);
+                        for (; q != positions[1].end() && *q <= p + k; ++q) {
+                            // a word repeated on both sides needs two occurrences
+                            if (*q == p) continue;
+                            matches++;
+                            break;
+                        }
+                    }
+                    return matches;
+                }));
+            }
+
+            // lines containing pattern anywhere, not only as a word. with the trigram index
+            // only the lines holding every trigram of pattern are read, else every line is
+            SearchResultType searchSubstring(const string& pattern) const {
+                return _searchLines({pattern}, [&pattern] (const string& line) { return line.find(pattern) != string::npos; });
+            }
 
-                for (const auto& doc : docs->second) {
-                    lineContent = _getLineContent(doc.docId, doc.offset);
-                    result.push_back(Result(doc.docId, _documents[doc.docId], doc.lineno, lineContent));
+            // lines with a match of the ECMAScript regex pattern, the trigram index is
+            // narrowed down by the literal strings every match contains
+            SearchResultType searchRegex(const string& pattern) const {
+                regex re;
+                try {
+                    re.assign(pattern);
+                } catch (const regex_error& e) {
+                    throw InvalidQuery("invalid regex " + pattern + ": " + e.what());
                 }
+                return _searchLines(TrigramIndex::literals(pattern), [&re] (const string& line) { return regex_search(line, re); });
+            }
 
-                return result;
+            // the k lines with the best BM25 score for any of the words of query, best first
+            RankedResultType searchTopK(const string& query, size_t k, const BM25& bm25 = BM25()) const {
+                auto lookup = [this] (StringRef word, PostingListRef& postings, size_t& maxTf) {
+                    auto docs = _index.find(_tokenizer.getWordId(word));
+                    if (docs == _index.end()) return false;
+                    postings = docs->second.ref();
+                    maxTf = docs->second.maxTf();
+                    return true;
+                };
+                auto lineLength = [this] (DocIdType docId, size_t lineno) { return _lineLengths[docId][lineno]; };
+                return _topK(query, k, bm25, _lineStatistics, lookup, lineLength);
+            }
+
+            // appends the postings of one document to index and the offset and length of
+            // its lines to lineOffsets and lineLengths, docId must be above every doc id already in index.
+            // returns the bytes the postings added to index, counting the nodes of new words
+            // but not the slack of the posting buffers
+            static size_t indexDocument(DocIdType docId, const string& docName, Tokenizer& tokenizer, InvertedIndexType& index,
+                                        LineOffsetTable& lineOffsets, vector<PositionType>& lineLengths,
+                                        TrigramIndex* trigrams = nullptr, PositionIndex* positions = nullptr) {
+                size_t bytes = 0;
+                LineReader doc(docName);
+                StringRef line;
+                size_t lineno = 0;
+                size_t offset = 0;
+                DelimiterSet delims;
+                vector<pair<WordIdType, PositionType>> tokens;
+                vector<PositionType> tokenPositions;
+
+                while (doc.next(line, offset)) {
+                    auto buf = tokenizer.tokenize(line, delims);
+                    // term frequencies and positions are bounded by the words of the line
+                    checkedId<PositionType>(lineno, "line number");
+                    auto lineLength = checkedId<PositionType>(buf.size(), "words on a line");
+                    lineOffsets.append(offset);
+                    lineLengths.push_back(lineLength);
+                    if (trigrams != nullptr) trigrams->add(docId, lineno, line);
+                    if (positions != nullptr) {
+                        // the positions of each word, in the order of the postings below
+                        tokens.clear();
+                        for (size_t i = 0; i < buf.size(); i++) tokens.push_back(make_pair(buf[i], static_cast<PositionType>(i)));
+                        sort(tokens.begin(), tokens.end());
+                        for (size_t i = 0, j = 0; i < tokens.size(); i = j) {
+                            tokenPositions.clear();
+                            for (; j < tokens.size() && tokens[j].first == tokens[i].first; j++) tokenPositions.push_back(tokens[j].second);
+                            positions->add(tokens[i].first, tokenPositions.data(), tokenPositions.size());
+                        }
+                    }
+
+                    // one posting per word with its count in the line
+                    sort(buf.begin(), buf.end());
+                    for (size_t i = 0, j = 0; i < buf.size(); i = j) {
+                        while (j < buf.size() && buf[j] == buf[i]) j++;
+                        auto& list = index[buf[i]];
+                        if (list.empty()) bytes += sizeof(InvertedIndexType::value_type) + 2 * sizeof(void*);
+                        size_t listBytes = list.bytes();
+                        list.append(InvertedIndexValueType(docId, lineno, j - i));
+                        bytes += list.bytes() - listBytes;
+                    }
+                    lineno += 1;
+                }
+                lineOffsets.shrink_to_fit();
+                return bytes;
             }
+
         private:
+            // a term with * or ? that is not a word itself is expanded as by searchWildcard,
+            // one ending in ~ or ~2 as by searchFuzzy with distance 1 or 2
+            PostingVectorType _queryPostings(const Query& query) const {
+                return query.evaluate([this] (const string& word) { return _termPostings(word); });
+            }
+
+            PostingVectorType _termPostings(const string& word) const {
+                auto docs = postings(word);
+                if (!docs.empty()) return PostingVectorType(docs.begin(), docs.end());
+
+                size_t maxDistance = Query::fuzzyDistance(word);
+                if (maxDistance != 0) return _fuzzyPostings(word.substr(0, word.find_last_of('~')), maxDistance);
+                if (word.find_first_of("*?") != string::npos) return _unitePostings(_terms.expand(word));
+                return PostingVectorType();
+            }
+
+            PostingVectorType _fuzzyPostings(const string& word, size_t maxDistance) const {
+                if (maxDistance > 2) throw InvalidQuery("fuzzy distance " + to_string(maxDistance) + " is more than 2");
+                return _unitePostings(_terms.fuzzy(word, maxDistance));
+            }
+
+            // the lines with every one of words whose positions, one list per word, pass match.
+            // tf is the number of matches match gives for the line
+            template <typename Match>
+            PostingVectorType _positionalPostings(const vector<string>& words, Match match) const {
+                if (!_hasPositions) throw InvalidQuery("the index was built without positions");
+                PostingVectorType ret;
+                if (words.empty()) return ret;
+
+                vector<const PostingList*> lists;
+                vector<PositionCursor<PostingList>> cursors;
+                for (const auto& word : words) {
+                    auto wordId = _tokenizer.getWordId(word);
+                    auto docs = _index.find(wordId);
+                    auto positions = _positions.find(wordId);
+                    if (docs == _index.end() || positions == nullptr) return ret;
+                    lists.push_back(&docs->second);
+                    cursors.push_back(PositionCursor<PostingList>(docs->second, *positions));
+                }
+
+                // the lines with all the words, the shortest list drives
+                auto shortest = *min_element(lists.begin(), lists.end(), [] (const PostingList* lhs, const PostingList* rhs) {
+                    return lhs->size() < rhs->size();
+                });
+                PostingVectorType candidates(shortest->begin(), shortest->end());
+                for (const auto list : lists) {
+                    if (list != shortest && !candidates.empty()) {
+                        candidates = Query::intersect(candidates, PostingVectorType(list->begin(), list->end()));
+                    }
+                }
+
+                vector<vector<PositionType>> positions(words.size());
+                for (auto doc : candidates) {
+                    for (size_t i = 0; i < cursors.size(); i++) cursors[i].seek(doc, positions[i]);
+                    size_t matches = match(positions);
+                    if (matches == 0) continue;
+                    doc.tf = matches;
+                    ret.push_back(doc);
+                }
+                return ret;
+            }
+
+            // the union of the lists of words, the counts of the words of one line are added up
+            PostingVectorType _unitePostings(const vector<WordIdType>& words) const {
+                PostingVectorType postings;
+                for (auto wordId : words) {
+                    auto docs = _index.find(wordId);
+                    if (docs != _index.end()) postings.insert(postings.end(), docs->second.begin(), docs->second.end());
+                }
+                sort(postings.begin(), postings.end());
+                PostingVectorType ret;
+                for (const auto& doc : postings) {
+                    if (!ret.empty() && !(ret.back() < doc)) {
+                        ret.back().tf += doc.tf;
+                    } else {
+                        ret.push_back(doc);
+                    }
+                }
+                return ret;
+            }
+
+            // the lines of the candidates the trigram index gives for literals that match,
+            // or of every line if it cannot narrow the search down
+            template <typename Match>
+            SearchResultType _searchLines(const vector<string>& literals, Match match) const {
+                SearchResultType result;
+                PostingVectorType candidates;
+                if (_hasTrigrams && _trigrams.candidates(literals, candidates)) {
+                    for (const auto& doc : candidates) {
+                        string lineContent = _getLineContent(doc.docId, _lineOffsets[doc.docId][doc.lineno]);
+                        if (match(lineContent)) result.push_back(Result(doc.docId, _documents[doc.docId], doc.lineno, lineContent));
+                    }
+                    return result;
+                }
+
+                for (DocIdType docId = 0; docId < _documents.size(); docId++) {
+                    LineReader doc(_dataDirectory + _documents[docId]);
+                    StringRef line;
+                    size_t offset;
+                    for (size_t lineno = 0; doc.next(line, offset); lineno++) {
+                        string lineContent = line.str();
+                        if (match(lineContent)) result.push_back(Result(docId, _documents[docId], lineno, lineContent));
+                    }
+                }
+                return result;
+            }
+
+            Result _result(const InvertedIndexValueType& doc) const {
+                return Result(doc.docId, _documents[doc.docId], doc.lineno, _getLineContent(doc.docId, _lineOffsets[doc.docId][doc.lineno]));
+            }
+
             string _getLineContent(DocIdType docId, size_t offset) const {
-                auto docName = _dataDirectory+_documents[docId];
-                ifstream doc(docName);
-                doc.seekg(offset);
-                
-                string line;
-                getline(doc, line);
-                doc.close();
-                return line;
+                return _fileCache.readLine(_dataDirectory+_documents[docId], offset);
             }
 
-            InvertedIndexType _buildInvertedIndex(const DocumentListType& documents) {
+            InvertedIndexType _buildInvertedIndex(const DocumentListType& documents, TrigramIndex* trigrams, PositionIndex* positions) {
                 InvertedIndexType index;
-                int documentNum = documents.size();
-                for (size_t i = 0; i< documentNum; i++) {
-                    _buildInvertedIndexAux(i, _dataDirectory+documents[i], index);
+                size_t documentNum = documents.size();
+                for (size_t i = 0; i < documentNum; i++) {
+                    indexDocument(i, _dataDirectory+documents[i], _tokenizer, index, _lineOffsets[i], _lineLengths[i], trigrams,
+                                  positions);
+                }
+                for (auto& i : index) {
+                    i.second.shrink_to_fit();
                 }
                 return index;
             }
 
-            void _buildInvertedIndexAux(DocIdType docId, const string& docName, InvertedIndexType& index) {
-                ifstream doc(docName);
-                string line;
-                size_t lineno = 0;
-                size_t offset = 0;
+            // every worker indexes a consecutive range of documents with its own tokenizer,
+            // the partial tokenizers are merged in document order so the word ids match
+            // the serial build, then the posting lists are concatenated by word id on all workers
+            InvertedIndexType _buildInvertedIndexParallel(const DocumentListType& documents, size_t threadNum,
+                                                          TrigramIndex* trigrams, PositionIndex* positions) {
+                size_t documentNum = documents.size();
+                threadNum = min(threadNum, documentNum);
+                if (threadNum <= 1) return _buildInvertedIndex(documents, trigrams, positions);
+
+                vector<Tokenizer> tokenizers(threadNum, Tokenizer(_tokenizer.avgWordLength()));
+                vector<InvertedIndexType> partials(threadNum);
+                vector<TrigramIndex> trigramPartials(threadNum);
+                vector<PositionIndex> positionPartials(threadNum);
+                vector<thread> workers;
+                for (size_t t = 0; t < threadNum; t++) {
+                    size_t first = documentNum * t / threadNum;
+                    size_t last = documentNum * (t + 1) / threadNum;
+                    TrigramIndex* partialTrigrams = (trigrams != nullptr ? &trigramPartials[t] : nullptr);
+                    PositionIndex* partialPositions = (positions != nullptr ? &positionPartials[t] : nullptr);
+                    workers.push_back(thread([this, &documents, &tokenizers, &partials, partialTrigrams, partialPositions,
+                                              t, first, last] () {
+                        for (size_t i = first; i < last; i++) {
+                            indexDocument(i, _dataDirectory+documents[i], tokenizers[t], partials[t], _lineOffsets[i], _lineLengths[i],
+                                          partialTrigrams, partialPositions);
+                        }
+                    }));
+                }
+                for (auto& worker : workers) worker.join();
+                if (trigrams != nullptr) {
+                    for (const auto& partial : trigramPartials) trigrams->append(partial);
+                }
 
-                while (getline(doc, line)) {
-                    auto buf = _tokenizer.tokenize(line);
-                    for (const auto& wordId : buf) {
-                        index[wordId].insert(InvertedIndexValueType(docId, offset, lineno));
+                vector<vector<WordIdType>> wordIds;
+                InvertedIndexType index;
+                for (size_t t = 0; t < threadNum; t++) {
+                    wordIds.push_back(_tokenizer.merge(tokenizers[t]));
+                    if (positions != nullptr) positions->append(positionPartials[t], wordIds[t]);
+                    for (const auto& i : partials[t]) {
+                        index[wordIds[t][i.first]];
                     }
-                    lineno += 1;
-                    offset = doc.tellg();
                 }
-                doc.close();
+
+                // the map is not modified any more, each worker only appends to its own words
+                workers.clear();
+                for (size_t m = 0; m < threadNum; m++) {
+                    workers.push_back(thread([&index, &partials, &wordIds, threadNum, m] () {
+                        for (size_t t = 0; t < partials.size(); t++) {
+                            for (const auto& i : partials[t]) {
+                                auto wordId = wordIds[t][i.first];
+                                if (wordId % threadNum != m) continue;
+                                index.find(wordId)->second.append(i.second);
+                            }
+                        }
+                        for (auto& i : index) {
+                            if (i.first % threadNum == m) i.second.shrink_to_fit();
+                        }
+                    }));
+                }
+                for (auto& worker : workers) worker.join();
+                return index;
             }
 
-            DocumentListType _fillDocList(const string& documents) const {
-                DocumentListType docList; 
-                ifstream content(documents);
-                string line;
-                while (getline(content, line)) {
-                    auto buf = _tokenizer.split(line);
-                    if (2 != buf.size()) continue;
-                    docList.push_back(buf[1]);
+            void _updateLineStatistics() {
+                _lineStatistics = LineStatistics();
+                for (const auto& doc : _lineLengths) {
+                    for (auto length : doc) _lineStatistics.add(length);
                 }
-                content.close();
-                return docList;
             }
     };
 
     template <typename Validator>
     struct SerializeFunc<IndexBuilderT<Validator>> {
-        void operator () (ofstream& fout, const IndexBuilderT<Validator>& indexBuilder) const {
-            SerializeFunc<Tokenizer>()(fout, indexBuilder._tokenizer);
-            SerializeFunc<string>()(fout, indexBuilder._dataDirectory);
-            SerializeFunc<DocumentListType>()(fout, indexBuilder._documents);
-            SerializeFunc<InvertedIndexType>()(fout, indexBuilder._index);
+        void operator () (ByteSink& fout, const IndexBuilderT<Validator>& indexBuilder) const {
+            writeIndexDump(fout, indexBuilder._tokenizer, indexBuilder._dataDirectory, indexBuilder._documents,
+                [&indexBuilder] (ByteSink& sink) { SerializeFunc<LineOffsetListType>()(sink, indexBuilder._lineOffsets); },
+                [&indexBuilder] (ByteSink& sink) { SerializeFunc<InvertedIndexType>()(sink, indexBuilder._index); },
+                [&indexBuilder] (ByteSink& sink) { SerializeFunc<LineLengthListType>()(sink, indexBuilder._lineLengths); },
+                indexBuilder._hasTrigrams ? &indexBuilder._trigrams : nullptr,
+                indexBuilder._hasPositions ? &indexBuilder._positions : nullptr);
         }
     };
 
     template <typename Validator>
     struct DeserializeFunc<IndexBuilderT<Validator>> {
-        void operator () (ifstream& fin, IndexBuilderT<Validator>& indexBuilder) const {
+        void operator () (ByteSource& fin, IndexBuilderT<Validator>& indexBuilder) const {
+            IdWidths widths;
+            DeserializeFunc<IdWidths>()(fin, widths);
             DeserializeFunc<Tokenizer>()(fin, indexBuilder._tokenizer);
             DeserializeFunc<string>()(fin, indexBuilder._dataDirectory);
             DeserializeFunc<DocumentListType>()(fin, indexBuilder._documents);
+            DeserializeFunc<LineOffsetListType>()(fin, indexBuilder._lineOffsets);
             DeserializeFunc<InvertedIndexType>()(fin, indexBuilder._index);
+            DeserializeFunc<LineLengthListType>()(fin, indexBuilder._lineLengths);
+            DeserializeFunc<bool>()(fin, indexBuilder._hasTrigrams);
+            DeserializeFunc<TrigramIndex>()(fin, indexBuilder._trigrams);
+            DeserializeFunc<bool>()(fin, indexBuilder._hasPositions);
+            DeserializeFunc<PositionIndex>()(fin, indexBuilder._positions);
+            indexBuilder._terms = TermDictionary(indexBuilder._tokenizer);
+            indexBuilder._updateLineStatistics();
         }
     };
 
@@ -266,10 +652,19 @@ namespace Darwin {
         if (lhs._documents != rhs._documents) return false;
         if (lhs._index != rhs._index) return false;
         if (lhs._dataDirectory != rhs._dataDirectory) return false;
+        if (lhs._lineOffsets != rhs._lineOffsets) return false;
+        if (lhs._lineLengths != rhs._lineLengths) return false;
+        if (lhs._hasTrigrams != rhs._hasTrigrams) return false;
+        if (lhs._trigrams != rhs._trigrams) return false;
+        if (lhs._hasPositions != rhs._hasPositions) return false;
+        if (lhs._positions != rhs._positions) return false;
         return true;
     }
 
     using IndexBuilder = IndexBuilderT<int>;
 }
 
+// freeze() is defined along with FrozenIndex, which needs the builder to be complete
+#include "FrozenIndex.hpp"
+
 #endif
@@ -0,0 +1,208 @@
+#ifndef __LAZYINDEX_HPP__
+#define __LAZYINDEX_HPP__
+
+#include <string>
+#include <vector>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <algorithm>
+#include <exception>
+#include <cerrno>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include "darwin.hpp"
+#include "ByteStream.hpp"
+#include "PostingList.hpp"
+#include "FileCache.hpp"
+#include "LineSearch.hpp"
+#include "IndexBuilder.hpp"
+
+namespace Darwin {
+    class LazyIndexError : public exception {
+        private:
+            string _message;
+        public:
+            LazyIndexError(const string& message) : _message(message) {}
+            virtual const char* what() const noexcept override {
+                return _message.c_str();
+            }
+    };
+
+    // LRU cache of posting lists by word id, bounded by their encoded size.
+    // the list just inserted is never evicted, even if it alone is over the bound
+    class PostingCache {
+        private:
+            using ListPtr = shared_ptr<const PostingList>;
+            using LruType = list<pair<WordIdType, ListPtr>>;
+
+            size_t _capacity;
+            size_t _bytes = 0;
+            mutable mutex _lock;
+            LruType _lru;
+            unordered_map<WordIdType, LruType::iterator> _lists;
+
+        public:
+            explicit PostingCache(size_t capacity) : _capacity(capacity) {}
+
+            size_t size() const {
+                lock_guard<mutex> guard(_lock);
+                return _lru.size();
+            }
+
+            size_t bytes() const {
+                lock_guard<mutex> guard(_lock);
+                return _bytes;
+            }
+
+            ListPtr find(WordIdType wordId) {
+                lock_guard<mutex> guard(_lock);
+                auto list = _lists.find(wordId);
+                if (list == _lists.end()) return ListPtr();
+                _lru.splice(_lru.begin(), _lru, list->second);
+                return list->second->second;
+            }
+
+            // returns the cached list, which is not postings if another thread got there first
+            ListPtr insert(WordIdType wordId, ListPtr postings) {
+                lock_guard<mutex> guard(_lock);
+                auto list = _lists.find(wordId);
+                if (list != _lists.end()) return list->second->second;
+
+                _lru.emplace_front(wordId, postings);
+                _lists[wordId] = _lru.begin();
+                _bytes += postings->bytes();
+                while (_bytes > _capacity && _lru.size() > 1) {
+                    _bytes -= _lru.back().second->bytes();
+                    _lists.erase(_lru.back().first);
+                    _lru.pop_back();
+                }
+                return postings;
+            }
+    };
+
+    // the postings of a word in a PostingCache, keeps the list it was read from alive
+    // while it is iterated
+    class CachedPostings {
+        private:
+            shared_ptr<const PostingList> _list;
+
+        public:
+            using value_type = InvertedIndexValueType;
+            using const_iterator = PostingIterator;
+
+            CachedPostings() {}
+            explicit CachedPostings(shared_ptr<const PostingList> list) : _list(move(list)) {}
+
+            const_iterator begin() const { return _list ? _list->begin() : const_iterator(); }
+            const_iterator end() const { return _list ? _list->end() : const_iterator(); }
+            size_t size() const { return _list ? _list->size() : 0; }
+            bool empty() const { return size() == 0; }
+    };
+
+    // opens a Serializer dump of an IndexBuilder without loading its postings: only the
+    // tokenizer, the documents, their line offsets and the posting list directory are read, a list is read
+    // with pread on its first lookup and kept in a PostingCache of cacheBytes
+    class LazyIndex : public LineSearch<LazyIndex, CachedPostings> {
+        friend LineSearch<LazyIndex, CachedPostings>;
+
+        public:
+            using Postings = CachedPostings;
+
+        private:
+            Tokenizer _tokenizer;
+            string _dataDirectory;
+            DocumentListType _documents;
+            LineOffsetListType _lineOffsets;
+            vector<PostingListHeader> _directory;
+            // file offset of every list in _directory
+            vector<size_t> _offsets;
+            int _fd = -1;
+            mutable PostingCache _cache;
+            mutable FileCache _fileCache;
+
+        public:
+            explicit LazyIndex(const string& fileName, size_t cacheBytes = 64 << 20) : _cache(cacheBytes) {
+                FileSource source(fileName);
+                if (!source.is_open()) throw LazyIndexError("cannot open " + fileName);
+                try {
+                    IdWidths widths;
+                    DeserializeFunc<IdWidths>()(source, widths);
+                } catch (const IdWidthMismatch& e) {
+                    throw LazyIndexError(fileName + ": " + e.what());
+                }
+                DeserializeFunc<Tokenizer>()(source, _tokenizer);
+                DeserializeFunc<string>()(source, _dataDirectory);
+                DeserializeFunc<DocumentListType>()(source, _documents);
+                DeserializeFunc<LineOffsetListType>()(source, _lineOffsets);
+                DeserializeFunc<vector<PostingListHeader>>()(source, _directory);
+                if (!source.good()) throw LazyIndexError("not an index: " + fileName);
+
+                size_t offset = source.tell();
+                _offsets.reserve(_directory.size());
+                for (const auto& header : _directory) {
+                    _offsets.push_back(offset);
+                    offset += header.bytes;
+                }
+
+                _fd = ::open(fileName.c_str(), O_RDONLY);
+                struct stat st;
+                if (_fd < 0 || fstat(_fd, &st) != 0 || static_cast<size_t>(st.st_size) < offset) {
+                    _close();
+                    throw LazyIndexError("not an index: " + fileName);
+                }
+            }
+            LazyIndex(const LazyIndex&) = delete;
+            LazyIndex& operator = (const LazyIndex&) = delete;
+            ~LazyIndex() {
+                _close();
+            }
+
+            const DocumentListType& documents() const { return _documents; }
+            const Tokenizer& tokenizer() const { return _tokenizer; }
+            const string& dataDirectory() const { return _dataDirectory; }
+            size_t termNum() const { return _directory.size(); }
+            const PostingCache& cache() const { return _cache; }
+
+            // empty if the word is unknown
+            Postings postings(StringRef word) const {
+                WordIdType wordId = _tokenizer.getWordId(word);
+                auto header = lower_bound(_directory.begin(), _directory.end(), wordId,
+                    [] (const PostingListHeader& header, WordIdType wordId) { return header.wordId < wordId; });
+                if (header == _directory.end() || header->wordId != wordId) return Postings();
+
+                auto list = _cache.find(wordId);
+                if (!list) list = _cache.insert(wordId, _read(header - _directory.begin()));
+                return Postings(list);
+            }
+
+        private:
+            shared_ptr<const PostingList> _read(size_t i) const {
+                const auto& header = _directory[i];
+                vector<unsigned char> data(header.bytes);
+                size_t length = 0;
+                while (length < data.size()) {
+                    ssize_t n = pread(_fd, data.data() + length, data.size() - length, _offsets[i] + length);
+                    if (n < 0 && errno == EINTR) continue;
+                    if (n <= 0) throw LazyIndexError("cannot read the postings of word " + to_string(header.wordId));
+                    length += n;
+                }
+                return make_shared<const PostingList>(move(data), header.size, header.last, header.maxTf);
+            }
+
+            Result _result(const InvertedIndexValueType& doc) const {
+                string lineContent = _fileCache.readLine(_dataDirectory + _documents[doc.docId],
+                                                          _lineOffsets[doc.docId][doc.lineno]);
+                return Result(doc.docId, _documents[doc.docId], doc.lineno, lineContent);
+            }
+
+            void _close() {
+                if (_fd >= 0) ::close(_fd);
+                _fd = -1;
+            }
+    };
+}
+
+#endif
@@ -0,0 +1,63 @@
+#ifndef __LEVENSHTEINAUTOMATON_HPP__
+#define __LEVENSHTEINAUTOMATON_HPP__
+
+#include <string>
+#include <vector>
+#include <algorithm>
+#include "darwin.hpp"
+
+namespace Darwin {
+    // accepts the strings within maxDistance insertions, deletions and substitutions of
+    // word. a state is the last row of the edit distance table between word and the bytes
+    // fed so far, capped at maxDistance + 1, so states only depend on what was fed and a
+    // walk over sorted words can keep the state of every prefix and drop a whole subtree
+    // of words once canMatch is false
+    class LevenshteinAutomaton {
+        private:
+            string _word;
+            unsigned char _limit;
+
+        public:
+            using State = vector<unsigned char>;
+
+            LevenshteinAutomaton(StringRef word, size_t maxDistance) :
+                _word(word.str()), _limit(static_cast<unsigned char>(min<size_t>(maxDistance, 254) + 1)) {}
+
+            size_t maxDistance() const { return _limit - 1; }
+
+            State start() const {
+                State state(_word.length() + 1);
+                for (size_t i = 0; i < state.size(); i++) state[i] = _cap(i);
+                return state;
+            }
+
+            State step(const State& state, char c) const {
+                State next(state.size());
+                next[0] = _cap(state[0] + 1);
+                for (size_t i = 1; i < state.size(); i++) {
+                    size_t cost = state[i - 1] + (_word[i - 1] == c ? 0 : 1);
+                    cost = min<size_t>(cost, state[i] + 1);
+                    cost = min<size_t>(cost, next[i - 1] + 1);
+                    next[i] = _cap(cost);
+                }
+                return next;
+            }
+
+            // the distance between word and what was fed, maxDistance() + 1 if it is larger
+            size_t distance(const State& state) const { return state.back(); }
+
+            bool isMatch(const State& state) const { return state.back() < _limit; }
+
+            // false if nothing fed after this state can lead to a match
+            bool canMatch(const State& state) const {
+                return *min_element(state.begin(), state.end()) < _limit;
+            }
+
+        private:
+            unsigned char _cap(size_t value) const {
+                return static_cast<unsigned char>(min<size_t>(value, _limit));
+            }
+    };
+}
+
+#endif
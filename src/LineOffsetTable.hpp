@@ -0,0 +1,110 @@
+#ifndef __LINEOFFSETTABLE_HPP__
+#define __LINEOFFSETTABLE_HPP__
+
+#include <vector>
+#include <cstdint>
+#include "darwin.hpp"
+#include "Serializer.hpp"
+#include "PostingList.hpp"
+
+namespace Darwin {
+    // non-owning view of the byte offsets of the lines of a document. every
+    // sampleRate-th line has its offset and the position of the next delta sampled,
+    // the other lines are varint deltas to the line before, so a lookup decodes at
+    // most sampleRate - 1 of them
+    class LineOffsetTableRef {
+        public:
+            static const size_t sampleRate = 32;
+
+        private:
+            // (offset, data position) pairs
+            const uint64_t* _samples = nullptr;
+            const unsigned char* _data = nullptr;
+            size_t _size = 0;
+
+        public:
+            LineOffsetTableRef() {}
+            LineOffsetTableRef(const uint64_t* samples, const unsigned char* data, size_t size) :
+                _samples(samples), _data(data), _size(size) {}
+
+            size_t size() const { return _size; }
+
+            // lineno must be below size()
+            size_t operator [] (size_t lineno) const {
+                size_t sample = lineno / sampleRate;
+                size_t offset = _samples[2 * sample];
+                const unsigned char* pos = _data + _samples[2 * sample + 1];
+                for (size_t i = sample * sampleRate; i < lineno; i++) {
+                    offset += VarByte::decode(pos);
+                }
+                return offset;
+            }
+    };
+
+    class LineOffsetTable {
+        friend SerializeFunc<LineOffsetTable>;
+        friend DeserializeFunc<LineOffsetTable>;
+
+        private:
+            vector<uint64_t> _samples;
+            vector<unsigned char> _data;
+            size_t _size = 0;
+            size_t _last = 0;
+
+        public:
+            LineOffsetTable() {}
+
+            // offsets are appended in line order
+            void append(size_t offset) {
+                if (_size % LineOffsetTableRef::sampleRate == 0) {
+                    _samples.push_back(offset);
+                    _samples.push_back(_data.size());
+                } else {
+                    VarByte::encode(_data, offset - _last);
+                }
+                _last = offset;
+                _size += 1;
+            }
+
+            void shrink_to_fit() {
+                _samples.shrink_to_fit();
+                _data.shrink_to_fit();
+            }
+
+            size_t size() const { return _size; }
+            size_t operator [] (size_t lineno) const { return ref()[lineno]; }
+
+            const vector<uint64_t>& samples() const { return _samples; }
+            const vector<unsigned char>& data() const { return _data; }
+            LineOffsetTableRef ref() const { return LineOffsetTableRef(_samples.data(), _data.data(), _size); }
+
+            bool operator == (const LineOffsetTable& rhs) const {
+                return _size == rhs._size && _samples == rhs._samples && _data == rhs._data;
+            }
+            bool operator != (const LineOffsetTable& rhs) const {
+                return !(*this == rhs);
+            }
+    };
+
+    template <>
+    struct SerializeFunc<LineOffsetTable> {
+        void operator () (ByteSink& fout, const LineOffsetTable& table) const {
+            SerializeFunc<size_t>()(fout, table._size);
+            SerializeFunc<size_t>()(fout, table._last);
+            SerializeFunc<vector<uint64_t>>()(fout, table._samples);
+            SerializeFunc<vector<unsigned char>>()(fout, table._data);
+        }
+    };
+
+    template <>
+    struct DeserializeFunc<LineOffsetTable> {
+        void operator () (ByteSource& fin, LineOffsetTable& table) const {
+            DeserializeFunc<size_t>()(fin, table._size);
+            DeserializeFunc<size_t>()(fin, table._last);
+            DeserializeFunc<vector<uint64_t>>()(fin, table._samples);
+            DeserializeFunc<vector<unsigned char>>()(fin, table._data);
+        }
+    };
+}
+
+#endif
@@ -0,0 +1,98 @@
+#ifndef __LINEREADER_HPP__
+#define __LINEREADER_HPP__
+
+#include <string>
+#include <vector>
+#include <cstring>
+#include <cerrno>
+#include <fcntl.h>
+#include <unistd.h>
+#include "darwin.hpp"
+
+namespace Darwin {
+    // reads a file in large blocks and splits it into lines with memchr. line offsets
+    // are counted from the bytes consumed, nothing is asked of the file position
+    class LineReader {
+        private:
+            int _fd = -1;
+            vector<char> _buffer;
+            size_t _begin = 0;
+            size_t _end = 0;
+            size_t _offset = 0;
+            bool _eof = false;
+
+        public:
+            explicit LineReader(const string& fileName, size_t blockSize = 1 << 20) :
+                _fd(::open(fileName.c_str(), O_RDONLY)), _buffer(blockSize) {
+                if (_fd < 0) {
+                    _eof = true;
+                    return;
+                }
+#ifdef POSIX_FADV_SEQUENTIAL
+                posix_fadvise(_fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+#endif
+            }
+            LineReader(const LineReader&) = delete;
+            LineReader& operator = (const LineReader&) = delete;
+            ~LineReader() {
+                if (_fd >= 0) ::close(_fd);
+            }
+
+            bool is_open() const { return _fd >= 0; }
+
+            // line excludes the '\n' and stays valid until the next call,
+            // offset is the byte offset of the line in the file
+            bool next(StringRef& line, size_t& offset) {
+                while (true) {
+                    const char* begin = _buffer.data() + _begin;
+                    const char* newline = static_cast<const char*>(memchr(begin, '\n', _end - _begin));
+                    if (newline != nullptr) {
+                        line = StringRef(begin, newline - begin);
+                        offset = _offset;
+                        _consume(newline - begin + 1);
+                        return true;
+                    }
+
+                    if (_eof) {
+                        // the last line has no '\n'
+                        if (_begin == _end) return false;
+                        line = StringRef(begin, _end - _begin);
+                        offset = _offset;
+                        _consume(_end - _begin);
+                        return true;
+                    }
+                    _fill();
+                }
+            }
+
+        private:
+            void _consume(size_t length) {
+                _begin += length;
+                _offset += length;
+            }
+
+            // keeps the partial line at the front of the buffer and reads behind it,
+            // the buffer doubles for lines longer than it
+            void _fill() {
+                if (_begin != 0) {
+                    memmove(_buffer.data(), _buffer.data() + _begin, _end - _begin);
+                    _end -= _begin;
+                    _begin = 0;
+                }
+                if (_end == _buffer.size()) _buffer.resize(2 * _buffer.size());
+
+                while (true) {
+                    ssize_t n = ::read(_fd, _buffer.data() + _end, _buffer.size() - _end);
+                    if (n > 0) {
+                        _end += n;
+                        return;
+                    }
+                    if (n < 0 && errno == EINTR) continue;
+                    _eof = true;
+                    return;
+                }
+            }
+    };
+}
+
+#endif
@@ -0,0 +1,118 @@
+#ifndef __LINESEARCH_HPP__
+#define __LINESEARCH_HPP__
+
+#include <string>
+#include <vector>
+#include <functional>
+#include <algorithm>
+#include "darwin.hpp"
+#include "PostingList.hpp"
+#include "DelimiterSet.hpp"
+#include "Query.hpp"
+#include "Ranking.hpp"
+#include "SearchCursor.hpp"
+
+namespace Darwin {
+    // the position of word among size words in byte order, where wordAt(i) is the i-th.
+    // size if word is not one of them
+    template <typename WordAt>
+    size_t findSorted(size_t size, StringRef word, WordAt wordAt) {
+        size_t first = 0;
+        size_t last = size;
+        while (first < last) {
+            size_t mid = first + (last - first) / 2;
+            if (wordAt(mid).compare(word) < 0) {
+                first = mid + 1;
+            } else {
+                last = mid;
+            }
+        }
+        if (first == size || wordAt(first) != word) return size;
+        return first;
+    }
+
+    // the searches every index answers the same way once it can find the postings of a
+    // word and read the line of a posting. Index derives from LineSearch<Index, Postings>,
+    // makes it a friend and provides
+    //   Postings postings(StringRef word)                the postings of a word, empty if it is unknown
+    //   Result _result(const InvertedIndexValueType&)    the hit of a posting, its line read
+    // and may hide _queryPostings to evaluate queries its own way
+    template <typename Index, typename Postings>
+    class LineSearch {
+        public:
+            SearchResultType search(const string& word) const {
+                return _fetch(_self().postings(word));
+            }
+
+            // lines matching a boolean query, content is only read for the final hits
+            SearchResultType search(const Query& query) const {
+                return _fetch(_self()._queryPostings(query));
+            }
+
+            // the hits of search(word) from offset on, a line is only read when its hit is consumed
+            SearchCursor<Postings> searchCursor(const string& word, size_t offset = 0,
+                                                size_t limit = SearchCursor<Postings>::npos) const {
+                return SearchCursor<Postings>(_self().postings(word), _resultFunc(), offset, limit);
+            }
+
+            SearchCursor<PostingVectorType> searchCursor(const Query& query, size_t offset = 0,
+                                                         size_t limit = SearchCursor<PostingVectorType>::npos) const {
+                return SearchCursor<PostingVectorType>(_self()._queryPostings(query), _resultFunc(), offset, limit);
+            }
+
+        protected:
+            // without a term dictionary wildcard and fuzzy terms cannot be expanded
+            PostingVectorType _queryPostings(const Query& query) const {
+                return query.evaluateWords([this] (const string& word) { return _self().postings(word); });
+            }
+
+            template <typename PostingRange>
+            SearchResultType _fetch(const PostingRange& postings) const {
+                SearchResultType result;
+                for (const auto& doc : postings) {
+                    result.push_back(_self()._result(doc));
+                }
+                return result;
+            }
+
+            function<Result (const InvertedIndexValueType&)> _resultFunc() const {
+                return [this] (const InvertedIndexValueType& doc) { return _self()._result(doc); };
+            }
+
+            // the k lines with the best BM25 score for any of the words of query, best first.
+            // lookup(word, postings, maxTf) finds the postings of a word and their highest tf,
+            // false if it has none. lineLength(docId, lineno) is the number of words of a line
+            template <typename Lookup, typename LineLength>
+            RankedResultType _topK(const string& query, size_t k, const BM25& bm25, const LineStatistics& statistics,
+                                   Lookup lookup, LineLength lineLength) const {
+                RankedResultType result;
+                if (statistics.lineNum == 0) return result;
+
+                double avgLength = statistics.avgLength();
+                vector<Wand<PostingListRef>::Term> terms;
+                vector<StringRef> words;
+                DelimiterSet(" ").forEachToken(query.data(), query.length(), [&] (size_t begin, size_t end) {
+                    StringRef word(query.data() + begin, end - begin);
+                    PostingListRef postings;
+                    size_t maxTf = 0;
+                    if (find(words.begin(), words.end(), word) != words.end() || !lookup(word, postings, maxTf)) return;
+                    words.push_back(word);
+
+                    // no line scores more than the highest tf on the shortest line
+                    double idf = bm25.idf(statistics.lineNum, postings.size());
+                    double maxScore = bm25.score(idf, maxTf, statistics.minLength, avgLength);
+                    terms.push_back({postings, idf, maxScore});
+                });
+
+                for (const auto& scored : Wand<PostingListRef>(bm25, avgLength).topK(terms, k, lineLength)) {
+                    result.push_back(RankedResult(scored.score, _self()._result(scored.posting)));
+                }
+                return result;
+            }
+
+        private:
+            const Index& _self() const { return static_cast<const Index&>(*this); }
+    };
+}
+
+#endif
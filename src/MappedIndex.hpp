@@ -0,0 +1,256 @@
+#ifndef __MAPPEDINDEX_HPP__
+#define __MAPPEDINDEX_HPP__
+
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <exception>
+#include <cstdint>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "darwin.hpp"
+#include "PostingList.hpp"
+#include "LineOffsetTable.hpp"
+#include "FileCache.hpp"
+#include "ByteStream.hpp"
+#include "LineSearch.hpp"
+#include "IndexBuilder.hpp"
+
+namespace Darwin {
+    class MappedIndexError : public exception {
+        private:
+            string _message;
+        public:
+            MappedIndexError(const string& message) : _message(message) {}
+            virtual const char* what() const noexcept override {
+                return _message.c_str();
+            }
+    };
+
+    // a flat, position independent index file that is queried straight from an mmap.
+    // every offset is relative to the start of the file, integers are native endian:
+    //
+    //   header
+    //   doc table   docNum + 1 offsets of the doc names in the string pool
+    //   term table  termNum term entries sorted by word
+    //   line table  docNum line entries
+    //   samples     the sampled line offsets of every document, see LineOffsetTable
+    //   string pool data directory, doc names and words
+    //   line data   the encoded line offset deltas of every document
+    //   postings    the encoded posting lists, see PostingList
+    //
+    // opening only maps and checks the header, pages are read in on first touch
+    // and shared with every other process mapping the same file
+    class MappedIndex : public LineSearch<MappedIndex, PostingListRef> {
+        friend LineSearch<MappedIndex, PostingListRef>;
+
+        private:
+            static const uint64_t _magic = 0x3258444957524144ULL;  // "DARWIDX2"
+
+            struct Header {
+                uint64_t magic;
+                uint64_t fileSize;
+                uint64_t docNum;
+                uint64_t docTableOffset;
+                uint64_t termNum;
+                uint64_t termTableOffset;
+                uint64_t lineTableOffset;
+                uint64_t stringPoolOffset;
+                uint64_t postingsOffset;
+                uint64_t dataDirectoryOffset;
+                uint64_t dataDirectoryLength;
+            };
+
+            struct TermEntry {
+                uint64_t wordOffset;
+                uint64_t wordLength;
+                uint64_t postingOffset;
+                uint64_t postingBytes;
+                uint64_t postingNum;
+            };
+
+            struct LineEntry {
+                uint64_t samplesOffset;
+                uint64_t dataOffset;
+                uint64_t lineNum;
+            };
+
+            const char* _base = nullptr;
+            size_t _length = 0;
+            mutable FileCache _fileCache;
+
+        public:
+            explicit MappedIndex(const string& fileName) {
+                int fd = ::open(fileName.c_str(), O_RDONLY);
+                if (fd < 0) throw MappedIndexError("cannot open " + fileName);
+
+                struct stat st;
+                if (fstat(fd, &st) != 0 || static_cast<size_t>(st.st_size) < sizeof(Header)) {
+                    ::close(fd);
+                    throw MappedIndexError("not a mapped index: " + fileName);
+                }
+                _length = st.st_size;
+
+                void* base = mmap(nullptr, _length, PROT_READ, MAP_SHARED, fd, 0);
+                ::close(fd);
+                if (base == MAP_FAILED) throw MappedIndexError("cannot map " + fileName);
+                _base = static_cast<const char*>(base);
+
+                if (_header().magic != _magic || _header().fileSize != _length) {
+                    _unmap();
+                    throw MappedIndexError("not a mapped index: " + fileName);
+                }
+            }
+            MappedIndex(const MappedIndex&) = delete;
+            MappedIndex& operator = (const MappedIndex&) = delete;
+            ~MappedIndex() {
+                _unmap();
+            }
+
+            size_t documentNum() const { return _header().docNum; }
+            size_t termNum() const { return _header().termNum; }
+
+            StringRef documentName(DocIdType docId) const {
+                const uint64_t* docTable = _at<uint64_t>(_header().docTableOffset);
+                return StringRef(_base + docTable[docId], docTable[docId + 1] - docTable[docId]);
+            }
+
+            LineOffsetTableRef lineOffsets(DocIdType docId) const {
+                const LineEntry& entry = _at<LineEntry>(_header().lineTableOffset)[docId];
+                return LineOffsetTableRef(_at<uint64_t>(entry.samplesOffset),
+                                          _at<unsigned char>(entry.dataOffset), entry.lineNum);
+            }
+
+            StringRef dataDirectory() const {
+                return StringRef(_base + _header().dataDirectoryOffset, _header().dataDirectoryLength);
+            }
+
+            // binary search over the sorted term table, empty if the word is unknown
+            PostingListRef postings(StringRef word) const {
+                const TermEntry* terms = _at<TermEntry>(_header().termTableOffset);
+                size_t term = findSorted(termNum(), word, [this, terms] (size_t i) { return _word(terms[i]); });
+                if (term == termNum()) return PostingListRef();
+
+                return PostingListRef(reinterpret_cast<const unsigned char*>(_base + terms[term].postingOffset),
+                                      terms[term].postingBytes, terms[term].postingNum);
+            }
+
+            template <typename Validator>
+            static void write(const string& fileName, const IndexBuilderT<Validator>& indexBuilder) {
+                const auto& documents = indexBuilder.documents();
+                const auto& index = indexBuilder.index();
+                const auto& lineOffsets = indexBuilder.lineOffsets();
+
+                vector<pair<StringRef, const PostingList*>> terms;
+                terms.reserve(index.size());
+                indexBuilder.tokenizer().forEachWord([&terms, &index] (StringRef word, WordIdType wordId) {
+                    auto postings = index.find(wordId);
+                    if (postings != index.end()) terms.push_back(make_pair(word, &postings->second));
+                });
+                sort(terms.begin(), terms.end(), [] (const pair<StringRef, const PostingList*>& lhs,
+                                                     const pair<StringRef, const PostingList*>& rhs) {
+                    return lhs.first.compare(rhs.first) < 0;
+                });
+
+                Header header;
+                header.magic = _magic;
+                header.docNum = documents.size();
+                header.docTableOffset = sizeof(Header);
+                header.termNum = terms.size();
+                header.termTableOffset = header.docTableOffset + (documents.size() + 1) * sizeof(uint64_t);
+                header.lineTableOffset = header.termTableOffset + terms.size() * sizeof(TermEntry);
+
+                vector<LineEntry> lineTable(documents.size());
+                uint64_t samplesOffset = header.lineTableOffset + documents.size() * sizeof(LineEntry);
+                for (size_t i = 0; i < documents.size(); i++) {
+                    lineTable[i].samplesOffset = samplesOffset;
+                    lineTable[i].lineNum = lineOffsets[i].size();
+                    samplesOffset += lineOffsets[i].samples().size() * sizeof(uint64_t);
+                }
+                header.stringPoolOffset = samplesOffset;
+
+                string pool = indexBuilder.dataDirectory();
+                header.dataDirectoryOffset = header.stringPoolOffset;
+                header.dataDirectoryLength = pool.length();
+
+                vector<uint64_t> docTable;
+                for (const auto& doc : documents) {
+                    docTable.push_back(header.stringPoolOffset + pool.length());
+                    pool += doc;
+                }
+                docTable.push_back(header.stringPoolOffset + pool.length());
+
+                vector<TermEntry> termTable;
+                for (const auto& term : terms) {
+                    TermEntry entry;
+                    entry.wordOffset = header.stringPoolOffset + pool.length();
+                    entry.wordLength = term.first.length();
+                    entry.postingBytes = term.second->bytes();
+                    entry.postingNum = term.second->size();
+                    termTable.push_back(entry);
+                    pool.append(term.first.data(), term.first.length());
+                }
+
+                uint64_t dataOffset = header.stringPoolOffset + pool.length();
+                for (size_t i = 0; i < documents.size(); i++) {
+                    lineTable[i].dataOffset = dataOffset;
+                    dataOffset += lineOffsets[i].data().size();
+                }
+
+                header.postingsOffset = dataOffset;
+                uint64_t postingOffset = header.postingsOffset;
+                for (auto& entry : termTable) {
+                    entry.postingOffset = postingOffset;
+                    postingOffset += entry.postingBytes;
+                }
+                header.fileSize = postingOffset;
+
+                FileSink fout(fileName);
+                fout.write(reinterpret_cast<const char*>(&header), sizeof(header));
+                fout.write(reinterpret_cast<const char*>(docTable.data()), docTable.size() * sizeof(uint64_t));
+                fout.write(reinterpret_cast<const char*>(termTable.data()), termTable.size() * sizeof(TermEntry));
+                fout.write(reinterpret_cast<const char*>(lineTable.data()), lineTable.size() * sizeof(LineEntry));
+                for (const auto& table : lineOffsets) {
+                    fout.write(reinterpret_cast<const char*>(table.samples().data()), table.samples().size() * sizeof(uint64_t));
+                }
+                fout.write(pool.data(), pool.length());
+                for (const auto& table : lineOffsets) {
+                    fout.write(reinterpret_cast<const char*>(table.data().data()), table.data().size());
+                }
+                for (const auto& term : terms) {
+                    fout.write(reinterpret_cast<const char*>(term.second->data()), term.second->bytes());
+                }
+                fout.close();
+                if (!fout.good()) throw MappedIndexError("cannot write " + fileName);
+            }
+
+        private:
+            Result _result(const InvertedIndexValueType& doc) const {
+                string docName = documentName(doc.docId).str();
+                string lineContent = _fileCache.readLine(dataDirectory().str() + docName, lineOffsets(doc.docId)[doc.lineno]);
+                return Result(doc.docId, docName, doc.lineno, lineContent);
+            }
+
+            const Header& _header() const {
+                return *reinterpret_cast<const Header*>(_base);
+            }
+
+            template <typename T>
+            const T* _at(uint64_t offset) const {
+                return reinterpret_cast<const T*>(_base + offset);
+            }
+
+            StringRef _word(const TermEntry& entry) const {
+                return StringRef(_base + entry.wordOffset, entry.wordLength);
+            }
+
+            void _unmap() {
+                if (_base != nullptr) munmap(const_cast<char*>(_base), _length);
+                _base = nullptr;
+            }
+    };
+}
+
+#endif
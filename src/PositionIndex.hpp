@@ -0,0 +1,135 @@
+#ifndef __POSITIONINDEX_HPP__
+#define __POSITIONINDEX_HPP__
+
+#include <vector>
+#include <unordered_map>
+#include <algorithm>
+#include "darwin.hpp"
+#include "Serializer.hpp"
+#include "PostingList.hpp"
+
+namespace Darwin {
+    // token positions of the postings of every word, kept apart from the postings so an
+    // index built without them is unchanged. the positions of a word are one buffer with
+    // the tf positions of each of its postings in posting order, the first of a line as
+    // is and every other one as the gap to the one before, VarByte encoded
+    class PositionIndex {
+        friend SerializeFunc<PositionIndex>;
+        friend DeserializeFunc<PositionIndex>;
+
+        private:
+            using MapType = unordered_map<WordIdType, vector<unsigned char>>;
+            MapType _lists;
+
+        public:
+            size_t size() const { return _lists.size(); }
+            bool empty() const { return _lists.empty(); }
+            void clear() { _lists.clear(); }
+
+            size_t bytes() const {
+                size_t ret = 0;
+                for (const auto& i : _lists) ret += i.second.capacity();
+                return ret;
+            }
+
+            // the positions of the next posting of wordId, in increasing order
+            void add(WordIdType wordId, const PositionType* positions, size_t size) {
+                auto& list = _lists[wordId];
+                PositionType last = 0;
+                for (size_t i = 0; i < size; i++) {
+                    VarByte::encode(list, positions[i] - last);
+                    last = positions[i];
+                }
+            }
+
+            // adds the lists of rhs, whose postings all come after the ones of this index.
+            // the word ids of rhs are mapped through wordIds, as given by TokenizerT::merge
+            void append(const PositionIndex& rhs, const vector<WordIdType>& wordIds) {
+                for (const auto& i : rhs._lists) {
+                    auto& list = _lists[wordIds[i.first]];
+                    list.insert(list.end(), i.second.begin(), i.second.end());
+                }
+            }
+
+            void shrink_to_fit() {
+                for (auto& i : _lists) i.second.shrink_to_fit();
+            }
+
+            // the encoded positions of wordId, nullptr if it has none
+            const vector<unsigned char>* find(WordIdType wordId) const {
+                auto list = _lists.find(wordId);
+                return list == _lists.end() ? nullptr : &list->second;
+            }
+
+            bool operator == (const PositionIndex& rhs) const { return _lists == rhs._lists; }
+            bool operator != (const PositionIndex& rhs) const { return _lists != rhs._lists; }
+    };
+
+    // walks the postings of a word together with their positions, for lines in increasing order
+    template <typename Postings>
+    class PositionCursor {
+        private:
+            typename Postings::const_iterator _posting;
+            typename Postings::const_iterator _end;
+            const unsigned char* _pos;
+
+        public:
+            PositionCursor(const Postings& postings, const vector<unsigned char>& positions) :
+                _posting(postings.begin()), _end(postings.end()), _pos(positions.data()) {}
+
+            // the positions of the word in the line of doc, false if it is not in that line.
+            // doc must not come before the line of the last call
+            bool seek(const InvertedIndexValueType& doc, vector<PositionType>& positions) {
+                positions.clear();
+                while (_posting != _end && *_posting < doc) {
+                    for (size_t i = 0; i < _posting->tf; i++) VarByte::decode(_pos);
+                    ++_posting;
+                }
+                if (_posting == _end || doc < *_posting) return false;
+
+                PositionType last = 0;
+                for (size_t i = 0; i < _posting->tf; i++) {
+                    last += VarByte::decode(_pos);
+                    positions.push_back(last);
+                }
+                ++_posting;
+                return true;
+            }
+    };
+
+    // the lists in word id order, so equal indexes give equal dumps
+    template <>
+    struct SerializeFunc<PositionIndex> {
+        void operator () (ByteSink& fout, const PositionIndex& index) const {
+            vector<const PositionIndex::MapType::value_type*> lists;
+            lists.reserve(index._lists.size());
+            for (const auto& i : index._lists) lists.push_back(&i);
+            sort(lists.begin(), lists.end(), [] (const PositionIndex::MapType::value_type* lhs,
+                                                 const PositionIndex::MapType::value_type* rhs) {
+                return lhs->first < rhs->first;
+            });
+            SerializeFunc<size_t>()(fout, lists.size());
+            for (const auto list : lists) {
+                SerializeFunc<WordIdType>()(fout, list->first);
+                SerializeFunc<vector<unsigned char>>()(fout, list->second);
+            }
+        }
+    };
+
+    template <>
+    struct DeserializeFunc<PositionIndex> {
+        void operator () (ByteSource& fin, PositionIndex& index) const {
+            size_t size = 0;
+            DeserializeFunc<size_t>()(fin, size);
+            index._lists.clear();
+            index._lists.reserve(size);
+            for (size_t i = 0; i < size; i++) {
+                WordIdType wordId = 0;
+                DeserializeFunc<WordIdType>()(fin, wordId);
+                DeserializeFunc<vector<unsigned char>>()(fin, index._lists[wordId]);
+            }
+        }
+    };
+}
+
+#endif
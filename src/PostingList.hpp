@@ -0,0 +1,276 @@
+#ifndef __POSTINGLIST_HPP__
+#define __POSTINGLIST_HPP__
+
+#include <vector>
+#include <algorithm>
+#include <iterator>
+#include <initializer_list>
+#include "darwin.hpp"
+#include "Serializer.hpp"
+
+namespace Darwin {
+    struct InvertedIndexValueType {
+        DocIdType docId;
+        // the byte offset of the line is looked up in the LineOffsetTable of the document
+        PositionType lineno;
+        // occurrences of the word in the line
+        PositionType tf;
+        InvertedIndexValueType(DocIdType docId, PositionType lineno, PositionType tf = 1) :
+            docId(docId), lineno(lineno), tf(tf) {}
+        InvertedIndexValueType(const InvertedIndexValueType& obj) = default;
+        InvertedIndexValueType() :
+            docId(0), lineno(0), tf(0) {}
+        bool operator == (const InvertedIndexValueType& rhs) const {
+            if (rhs.docId != docId) return false;
+            if (rhs.lineno != lineno) return false;
+            if (rhs.tf != tf) return false;
+            return true;
+        }
+        bool operator != (const InvertedIndexValueType& rhs) const {
+            return !(*this == rhs);
+        }
+        // postings are ordered by (docId, lineno)
+        bool operator < (const InvertedIndexValueType& rhs) const {
+            if (docId != rhs.docId) return docId < rhs.docId;
+            return lineno < rhs.lineno;
+        }
+    };
+
+    // three unpadded words, the same bytes the field by field SerializeFunc writes
+    template <>
+    struct IsBulkSerializable<InvertedIndexValueType> : integral_constant<bool,
+        sizeof(InvertedIndexValueType) == sizeof(DocIdType) + 2 * sizeof(PositionType)> {};
+
+    template <>
+    struct SerializeFunc<InvertedIndexValueType> {
+        void operator () (ByteSink& fout, const InvertedIndexValueType& v) const {
+            SerializeFunc<DocIdType>()(fout, v.docId);
+            SerializeFunc<PositionType>()(fout, v.lineno);
+            SerializeFunc<PositionType>()(fout, v.tf);
+        }
+    };
+
+    template <>
+    struct DeserializeFunc<InvertedIndexValueType> {
+        void operator () (ByteSource& fin, InvertedIndexValueType& v) const {
+            DeserializeFunc<DocIdType>()(fin, v.docId);
+            DeserializeFunc<PositionType>()(fin, v.lineno);
+            DeserializeFunc<PositionType>()(fin, v.tf);
+        }
+    };
+
+    struct HashFunc {
+        size_t operator() (const InvertedIndexValueType &val) const {
+            std::hash<PositionType> hasher;
+            size_t ret = val.docId;
+            ret ^= hasher(val.lineno) + 0x9e3779b9 + (ret << 6) + (ret >> 2);
+            return ret;
+        }
+    };
+
+    // variable-byte integers: 7 bits per byte, high bit set on every byte but the last
+    struct VarByte {
+        static void encode(vector<unsigned char>& buf, size_t val) {
+            while (val >= 0x80) {
+                buf.push_back(static_cast<unsigned char>(val | 0x80));
+                val >>= 7;
+            }
+            buf.push_back(static_cast<unsigned char>(val));
+        }
+
+        static size_t decode(const unsigned char*& pos) {
+            size_t val = 0;
+            unsigned shift = 0;
+            while (*pos & 0x80) {
+                val |= static_cast<size_t>(*pos++ & 0x7f) << shift;
+                shift += 7;
+            }
+            val |= static_cast<size_t>(*pos++) << shift;
+            return val;
+        }
+    };
+
+    // decodes a delta + varint encoded posting buffer in (docId, lineno) order
+    class PostingIterator : public iterator<forward_iterator_tag, InvertedIndexValueType,
+                                            ptrdiff_t, const InvertedIndexValueType*, const InvertedIndexValueType&> {
+        private:
+            const unsigned char* _pos = nullptr;
+            const unsigned char* _next = nullptr;
+            const unsigned char* _end = nullptr;
+            InvertedIndexValueType _value;
+
+        public:
+            PostingIterator() {}
+            PostingIterator(const unsigned char* begin, const unsigned char* end) :
+                _pos(begin), _next(begin), _end(end) {
+                _decode();
+            }
+
+            const InvertedIndexValueType& operator * () const { return _value; }
+            const InvertedIndexValueType* operator -> () const { return &_value; }
+
+            PostingIterator& operator ++ () {
+                _pos = _next;
+                _decode();
+                return *this;
+            }
+            PostingIterator operator ++ (int) {
+                PostingIterator tmp(*this);
+                ++(*this);
+                return tmp;
+            }
+
+            bool operator == (const PostingIterator& rhs) const { return _pos == rhs._pos; }
+            bool operator != (const PostingIterator& rhs) const { return _pos != rhs._pos; }
+
+        private:
+            void _decode() {
+                if (_next == _end) return;
+                size_t docDelta = VarByte::decode(_next);
+                if (docDelta == 0) {
+                    _value.lineno += VarByte::decode(_next);
+                } else {
+                    _value.docId += docDelta;
+                    _value.lineno = VarByte::decode(_next);
+                }
+                _value.tf = VarByte::decode(_next);
+            }
+    };
+
+    // non-owning view of an encoded posting buffer, e.g. one inside a mapped index file
+    class PostingListRef {
+        private:
+            const unsigned char* _data = nullptr;
+            size_t _bytes = 0;
+            size_t _size = 0;
+
+        public:
+            using value_type = InvertedIndexValueType;
+            using const_iterator = PostingIterator;
+            using iterator = PostingIterator;
+
+            PostingListRef() {}
+            PostingListRef(const unsigned char* data, size_t bytes, size_t size) :
+                _data(data), _bytes(bytes), _size(size) {}
+
+            const_iterator begin() const { return const_iterator(_data, _data + _bytes); }
+            const_iterator end() const { return const_iterator(_data + _bytes, _data + _bytes); }
+
+            size_t size() const { return _size; }
+            bool empty() const { return _size == 0; }
+            size_t bytes() const { return _bytes; }
+            const unsigned char* data() const { return _data; }
+    };
+
+    // immutable-once-built posting list: postings are appended in (docId, lineno) order
+    // and stored delta encoded in one contiguous buffer
+    class PostingList {
+        friend SerializeFunc<PostingList>;
+        friend DeserializeFunc<PostingList>;
+
+        private:
+            vector<unsigned char> _data;
+            size_t _size = 0;
+            InvertedIndexValueType _last;
+            size_t _maxTf = 0;
+
+        public:
+            using value_type = InvertedIndexValueType;
+            using const_iterator = PostingIterator;
+            using iterator = PostingIterator;
+
+            PostingList() {}
+            // adopts already encoded postings, last is the last one of them
+            PostingList(vector<unsigned char>&& data, size_t size, const InvertedIndexValueType& last, size_t maxTf) :
+                _data(move(data)), _size(size), _last(last), _maxTf(maxTf) {}
+            PostingList(initializer_list<InvertedIndexValueType> values) {
+                vector<InvertedIndexValueType> sorted(values);
+                sort(sorted.begin(), sorted.end());
+                for (const auto& v : sorted) append(v);
+            }
+
+            // v must not be less than the last appended posting, repeats of the last one are dropped
+            void append(const InvertedIndexValueType& v) {
+                if (_size != 0 && v.docId == _last.docId && v.lineno == _last.lineno) return;
+
+                // a zero doc delta means lineno is a delta too, the first posting is
+                // encoded relative to the all zero posting. tf is never a delta
+                if (v.docId == _last.docId) {
+                    VarByte::encode(_data, 0);
+                    VarByte::encode(_data, v.lineno - _last.lineno);
+                } else {
+                    VarByte::encode(_data, v.docId - _last.docId);
+                    VarByte::encode(_data, v.lineno);
+                }
+                VarByte::encode(_data, v.tf);
+                _last = v;
+                _size += 1;
+                _maxTf = max<size_t>(_maxTf, v.tf);
+            }
+
+            // appends every posting of rhs, rhs must not start before the last posting.
+            // only the first posting of rhs is re-encoded, the rest of its deltas are copied
+            void append(const PostingList& rhs) {
+                if (rhs.empty()) return;
+
+                const unsigned char* pos = rhs._data.data();
+                InvertedIndexValueType first;
+                first.docId = VarByte::decode(pos);
+                first.lineno = VarByte::decode(pos);
+                first.tf = VarByte::decode(pos);
+
+                size_t size = _size;
+                append(first);
+                _data.insert(_data.end(), pos, rhs._data.data() + rhs._data.size());
+                _size = size + rhs._size - (_size == size ? 1 : 0);
+                _last = rhs._last;
+                _maxTf = max(_maxTf, rhs._maxTf);
+            }
+
+            void shrink_to_fit() { _data.shrink_to_fit(); }
+
+            const_iterator begin() const { return const_iterator(_data.data(), _data.data() + _data.size()); }
+            const_iterator end() const {
+                return const_iterator(_data.data() + _data.size(), _data.data() + _data.size());
+            }
+
+            size_t size() const { return _size; }
+            bool empty() const { return _size == 0; }
+            size_t bytes() const { return _data.size(); }
+            const unsigned char* data() const { return _data.data(); }
+            const InvertedIndexValueType& last() const { return _last; }
+            size_t maxTf() const { return _maxTf; }
+            PostingListRef ref() const { return PostingListRef(_data.data(), _data.size(), _size); }
+
+            bool operator == (const PostingList& rhs) const {
+                if (_size != rhs._size) return false;
+                if (_data != rhs._data) return false;
+                return true;
+            }
+            bool operator != (const PostingList& rhs) const {
+                return !(*this == rhs);
+            }
+    };
+
+    template <>
+    struct SerializeFunc<PostingList> {
+        void operator () (ByteSink& fout, const PostingList& list) const {
+            SerializeFunc<size_t>()(fout, list._size);
+            SerializeFunc<InvertedIndexValueType>()(fout, list._last);
+            SerializeFunc<size_t>()(fout, list._maxTf);
+            SerializeFunc<vector<unsigned char>>()(fout, list._data);
+        }
+    };
+
+    template <>
+    struct DeserializeFunc<PostingList> {
+        void operator () (ByteSource& fin, PostingList& list) const {
+            DeserializeFunc<size_t>()(fin, list._size);
+            DeserializeFunc<InvertedIndexValueType>()(fin, list._last);
+            DeserializeFunc<size_t>()(fin, list._maxTf);
+            DeserializeFunc<vector<unsigned char>>()(fin, list._data);
+        }
+    };
+}
+
+#endif
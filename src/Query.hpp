@@ -0,0 +1,219 @@
+#ifndef __QUERY_HPP__
+#define __QUERY_HPP__
+
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <exception>
+#include "darwin.hpp"
+#include "PostingList.hpp"
+
+namespace Darwin {
+    class InvalidQuery : public exception {
+        private:
+            string _message;
+        public:
+            InvalidQuery(const string& message) : _message(message) {}
+            virtual const char* what() const noexcept override {
+                return _message.c_str();
+            }
+    };
+
+    using PostingVectorType = vector<InvertedIndexValueType>;
+
+    // boolean query over words, evaluated at (docId, lineno) level. NOT is only
+    // allowed as an AND operand, there is no list of every line to subtract from
+    class Query {
+        public:
+            enum Type { TERM, AND, OR, NOT };
+
+        private:
+            Type _type;
+            string _word;
+            vector<Query> _children;
+
+            Query(Type type, const string& word, const vector<Query>& children) :
+                _type(type), _word(word), _children(children) {}
+
+        public:
+            static Query term(const string& word) { return Query(TERM, word, {}); }
+            static Query makeAnd(const vector<Query>& children) { return Query(AND, "", children); }
+            static Query makeOr(const vector<Query>& children) { return Query(OR, "", children); }
+            static Query makeNot(const Query& child) { return Query(NOT, "", {child}); }
+
+            // words, AND, OR, NOT and parentheses, adjacent operands are ANDed:
+            //   harry AND (potter OR NOT dream)
+            static Query parse(const string& query) {
+                vector<string> tokens;
+                string token;
+                for (auto c : query) {
+                    if (c == ' ' || c == '(' || c == ')') {
+                        if (!token.empty()) tokens.push_back(token);
+                        token.clear();
+                        if (c != ' ') tokens.push_back(string(1, c));
+                    } else {
+                        token.push_back(c);
+                    }
+                }
+                if (!token.empty()) tokens.push_back(token);
+
+                size_t pos = 0;
+                Query ret = _parseOr(tokens, pos);
+                if (pos != tokens.size()) throw InvalidQuery("unexpected " + tokens[pos] + " in " + query);
+                return ret;
+            }
+
+            Type type() const { return _type; }
+            const string& word() const { return _word; }
+            const vector<Query>& children() const { return _children; }
+
+            // postings matching the query in (docId, lineno) order. lookup(word) returns
+            // the posting list of a word, something iterable in that order
+            template <typename Lookup>
+            PostingVectorType evaluate(Lookup lookup) const {
+                if (_type == NOT) throw InvalidQuery("NOT needs a positive AND operand");
+
+                if (_type == TERM) {
+                    auto postings = lookup(_word);
+                    return PostingVectorType(postings.begin(), postings.end());
+                }
+
+                vector<PostingVectorType> positives;
+                vector<PostingVectorType> negatives;
+                for (const auto& child : _children) {
+                    if (child._type == NOT && _type == AND) {
+                        negatives.push_back(child._children[0].evaluate(lookup));
+                    } else {
+                        positives.push_back(child.evaluate(lookup));
+                    }
+                }
+                if (positives.empty()) throw InvalidQuery("NOT needs a positive AND operand");
+
+                if (_type == OR) {
+                    PostingVectorType ret = move(positives[0]);
+                    for (size_t i = 1; i < positives.size(); i++) {
+                        ret = unite(ret, positives[i]);
+                    }
+                    return ret;
+                }
+
+                // the smallest list drives, every other one is galloped through
+                sort(positives.begin(), positives.end(), [] (const PostingVectorType& lhs, const PostingVectorType& rhs) {
+                    return lhs.size() < rhs.size();
+                });
+                PostingVectorType ret = move(positives[0]);
+                for (size_t i = 1; i < positives.size() && !ret.empty(); i++) {
+                    ret = intersect(ret, positives[i]);
+                }
+                for (size_t i = 0; i < negatives.size() && !ret.empty(); i++) {
+                    ret = subtract(ret, negatives[i]);
+                }
+                return ret;
+            }
+
+            // the same, for an index without a term dictionary: a wildcard or fuzzy term
+            // that is not a word itself throws InvalidQuery rather than matching nothing
+            template <typename Lookup>
+            PostingVectorType evaluateWords(Lookup lookup) const {
+                return evaluate([&lookup] (const string& word) -> decltype(lookup(word)) {
+                    auto postings = lookup(word);
+                    if (postings.begin() == postings.end() && isPattern(word)) {
+                        throw InvalidQuery("only IndexBuilder expands wildcard and fuzzy terms: " + word);
+                    }
+                    return postings;
+                });
+            }
+
+            // the edit distance of a fuzzy term, 1 for word~ or word~1 and 2 for word~2,
+            // 0 if word is not one
+            static size_t fuzzyDistance(const string& word) {
+                auto tilde = word.find_last_of('~');
+                if (tilde == string::npos || tilde == 0) return 0;
+                if (tilde + 1 == word.length()) return 1;
+                if (tilde + 2 != word.length() || (word[tilde + 1] != '1' && word[tilde + 1] != '2')) return 0;
+                return word[tilde + 1] - '0';
+            }
+
+            // whether word is a wildcard term, with * or ?, or a fuzzy one
+            static bool isPattern(const string& word) {
+                return word.find_first_of("*?") != string::npos || fuzzyDistance(word) != 0;
+            }
+
+            // the first position at or after from whose posting is not less than target,
+            // probing from, from+1, from+2, from+4 ... before a binary search
+            static size_t gallop(const PostingVectorType& postings, size_t from, const InvertedIndexValueType& target) {
+                size_t size = postings.size();
+                if (from >= size || !(postings[from] < target)) return from;
+
+                size_t bound = 1;
+                while (from + bound < size && postings[from + bound] < target) bound *= 2;
+                auto first = postings.begin() + from + bound / 2 + 1;
+                auto last = postings.begin() + min(from + bound + 1, size);
+                return lower_bound(first, last, target) - postings.begin();
+            }
+
+            static PostingVectorType intersect(const PostingVectorType& small, const PostingVectorType& large) {
+                PostingVectorType ret;
+                size_t pos = 0;
+                for (const auto& p : small) {
+                    pos = gallop(large, pos, p);
+                    if (pos == large.size()) break;
+                    if (!(p < large[pos])) ret.push_back(p);
+                }
+                return ret;
+            }
+
+            static PostingVectorType subtract(const PostingVectorType& postings, const PostingVectorType& excluded) {
+                PostingVectorType ret;
+                size_t pos = 0;
+                for (const auto& p : postings) {
+                    pos = gallop(excluded, pos, p);
+                    if (pos == excluded.size() || p < excluded[pos]) ret.push_back(p);
+                }
+                return ret;
+            }
+
+            static PostingVectorType unite(const PostingVectorType& lhs, const PostingVectorType& rhs) {
+                PostingVectorType ret;
+                ret.reserve(lhs.size() + rhs.size());
+                set_union(lhs.begin(), lhs.end(), rhs.begin(), rhs.end(), back_inserter(ret));
+                return ret;
+            }
+
+        private:
+            static Query _parseOr(const vector<string>& tokens, size_t& pos) {
+                vector<Query> children = {_parseAnd(tokens, pos)};
+                while (pos < tokens.size() && tokens[pos] == "OR") {
+                    pos += 1;
+                    children.push_back(_parseAnd(tokens, pos));
+                }
+                return children.size() == 1 ? children[0] : makeOr(children);
+            }
+
+            static Query _parseAnd(const vector<string>& tokens, size_t& pos) {
+                vector<Query> children = {_parseUnary(tokens, pos)};
+                while (pos < tokens.size() && tokens[pos] != "OR" && tokens[pos] != ")") {
+                    if (tokens[pos] == "AND") pos += 1;
+                    children.push_back(_parseUnary(tokens, pos));
+                }
+                return children.size() == 1 ? children[0] : makeAnd(children);
+            }
+
+            static Query _parseUnary(const vector<string>& tokens, size_t& pos) {
+                if (pos == tokens.size()) throw InvalidQuery("unexpected end of query");
+
+                const auto& token = tokens[pos++];
+                if (token == "NOT") return makeNot(_parseUnary(tokens, pos));
+                if (token == "(") {
+                    Query ret = _parseOr(tokens, pos);
+                    if (pos == tokens.size() || tokens[pos] != ")") throw InvalidQuery("missing )");
+                    pos += 1;
+                    return ret;
+                }
+                if (token == ")" || token == "AND" || token == "OR") throw InvalidQuery("unexpected " + token);
+                return term(token);
+            }
+    };
+}
+
+#endif
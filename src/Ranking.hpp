@@ -0,0 +1,153 @@
+#ifndef __RANKING_HPP__
+#define __RANKING_HPP__
+
+#include <vector>
+#include <algorithm>
+#include <cmath>
+#include "darwin.hpp"
+#include "PostingList.hpp"
+
+namespace Darwin {
+    // Okapi BM25 over lines: a line is the document, its length is its number of words
+    struct BM25 {
+        double k1 = 1.2;
+        double b = 0.75;
+
+        BM25() {}
+        BM25(double k1, double b) : k1(k1), b(b) {}
+
+        // lineNum lines in the collection, df of them contain the word
+        double idf(size_t lineNum, size_t df) const {
+            return log(1.0 + (lineNum - df + 0.5) / (df + 0.5));
+        }
+
+        double score(double idf, size_t tf, size_t length, double avgLength) const {
+            double norm = 1.0 - b + b * length / avgLength;
+            return idf * tf * (k1 + 1.0) / (tf + k1 * norm);
+        }
+    };
+
+    // the line lengths BM25 needs, over every line of an index
+    struct LineStatistics {
+        size_t lineNum = 0;
+        size_t totalLength = 0;
+        // of the shortest line that is not empty
+        size_t minLength = 0;
+
+        void add(size_t length) {
+            lineNum += 1;
+            totalLength += length;
+            if (length != 0 && (minLength == 0 || length < minLength)) minLength = length;
+        }
+
+        double avgLength() const { return static_cast<double>(totalLength) / lineNum; }
+    };
+
+    struct ScoredPosting {
+        InvertedIndexValueType posting;
+        double score;
+
+        ScoredPosting(const InvertedIndexValueType& posting, double score) : posting(posting), score(score) {}
+
+        // higher scores first, ties go to the earlier line
+        bool operator < (const ScoredPosting& rhs) const {
+            if (score != rhs.score) return score > rhs.score;
+            return posting < rhs.posting;
+        }
+    };
+
+    // the k best lines for a disjunction of words by WAND: every word has an upper bound
+    // of its score on any line, a line is only scored when the bounds of the words on or
+    // before it could beat the k-th best score so far, the others are skipped
+    template <typename Postings>
+    class Wand {
+        public:
+            struct Term {
+                Postings postings;
+                double idf;
+                double maxScore;
+            };
+
+        private:
+            struct Cursor {
+                PostingIterator pos;
+                PostingIterator end;
+                const Term* term;
+            };
+
+            BM25 _bm25;
+            double _avgLength;
+
+        public:
+            Wand(const BM25& bm25, double avgLength) : _bm25(bm25), _avgLength(avgLength) {}
+
+            // lineLength(docId, lineno) is the number of words of a line, the result is best first
+            template <typename LineLength>
+            vector<ScoredPosting> topK(const vector<Term>& terms, size_t k, LineLength lineLength) const {
+                vector<ScoredPosting> heap;
+                if (k == 0) return heap;
+
+                vector<Cursor> cursors;
+                for (const auto& term : terms) {
+                    Cursor cursor = {term.postings.begin(), term.postings.end(), &term};
+                    if (cursor.pos != cursor.end) cursors.push_back(cursor);
+                }
+                auto byPosting = [] (const Cursor& lhs, const Cursor& rhs) { return *lhs.pos < *rhs.pos; };
+
+                while (!cursors.empty()) {
+                    sort(cursors.begin(), cursors.end(), byPosting);
+                    double threshold = (heap.size() < k ? -1.0 : heap.front().score);
+
+                    // the first cursor where the bounds so far beat the threshold
+                    size_t pivot = 0;
+                    double bound = 0;
+                    for (; pivot < cursors.size(); pivot++) {
+                        bound += cursors[pivot].term->maxScore;
+                        if (bound > threshold) break;
+                    }
+                    if (pivot == cursors.size()) break;
+                    InvertedIndexValueType target = *cursors[pivot].pos;
+
+                    if (_sameLine(*cursors[0].pos, target)) {
+                        double score = 0;
+                        size_t length = lineLength(target.docId, target.lineno);
+                        for (auto& cursor : cursors) {
+                            if (!_sameLine(*cursor.pos, target)) break;
+                            score += _bm25.score(cursor.term->idf, cursor.pos->tf, length, _avgLength);
+                            ++cursor.pos;
+                        }
+                        _push(heap, k, ScoredPosting(target, score));
+                    } else {
+                        // no line before target can make it, skip them unscored
+                        for (size_t i = 0; i < pivot; i++) {
+                            while (cursors[i].pos != cursors[i].end && *cursors[i].pos < target) ++cursors[i].pos;
+                        }
+                    }
+                    cursors.erase(remove_if(cursors.begin(), cursors.end(),
+                        [] (const Cursor& cursor) { return cursor.pos == cursor.end; }), cursors.end());
+                }
+
+                sort_heap(heap.begin(), heap.end());
+                return heap;
+            }
+
+        private:
+            static bool _sameLine(const InvertedIndexValueType& lhs, const InvertedIndexValueType& rhs) {
+                return lhs.docId == rhs.docId && lhs.lineno == rhs.lineno;
+            }
+
+            // heap.front() is the worst of the k best
+            static void _push(vector<ScoredPosting>& heap, size_t k, const ScoredPosting& scored) {
+                if (heap.size() < k) {
+                    heap.push_back(scored);
+                    push_heap(heap.begin(), heap.end());
+                } else if (scored < heap.front()) {
+                    pop_heap(heap.begin(), heap.end());
+                    heap.back() = scored;
+                    push_heap(heap.begin(), heap.end());
+                }
+            }
+    };
+}
+
+#endif
@@ -0,0 +1,79 @@
+#ifndef __SEARCHCURSOR_HPP__
+#define __SEARCHCURSOR_HPP__
+
+#include <functional>
+#include <limits>
+#include <algorithm>
+#include "darwin.hpp"
+#include "PostingList.hpp"
+
+namespace Darwin {
+    // yields the hits of a search one at a time. the line of a hit is only read when
+    // the hit is consumed, skipped hits are decoded but never read. offset hits are
+    // skipped up front and at most limit hits are yielded after them
+    template <typename Postings>
+    class SearchCursor {
+        public:
+            using FetchType = function<Result (const InvertedIndexValueType&)>;
+            static const size_t npos = numeric_limits<size_t>::max();
+
+        private:
+            // the iterators point into _postings, so a cursor can be moved but not copied
+            Postings _postings;
+            typename Postings::const_iterator _pos;
+            typename Postings::const_iterator _end;
+            FetchType _fetch;
+            size_t _remaining;
+
+        public:
+            SearchCursor(Postings postings, FetchType fetch, size_t offset = 0, size_t limit = npos) :
+                _postings(move(postings)), _pos(_postings.begin()), _end(_postings.end()),
+                _fetch(move(fetch)), _remaining(limit) {
+                _advance(offset);
+            }
+            SearchCursor(SearchCursor&& rhs) = default;
+            SearchCursor(const SearchCursor&) = delete;
+            SearchCursor& operator = (const SearchCursor&) = delete;
+
+            bool done() const { return _remaining == 0 || _pos == _end; }
+
+            // the next hit, the cursor must not be done
+            Result next() {
+                Result result = _fetch(*_pos);
+                ++_pos;
+                _remaining -= 1;
+                return result;
+            }
+
+            // skips up to n hits without reading their lines, they count against the limit.
+            // returns how many were skipped
+            size_t skip(size_t n) {
+                size_t skipped = _advance(min(n, _remaining));
+                _remaining -= skipped;
+                return skipped;
+            }
+
+            // calls func on every remaining hit until it returns false, returns the number of calls
+            template <typename Func>
+            size_t forEach(Func func) {
+                size_t calls = 0;
+                while (!done()) {
+                    calls += 1;
+                    if (!func(next())) break;
+                }
+                return calls;
+            }
+
+        private:
+            size_t _advance(size_t n) {
+                size_t advanced = 0;
+                for (; advanced < n && _pos != _end; advanced++) ++_pos;
+                return advanced;
+            }
+    };
+
+    template <typename Postings>
+    const size_t SearchCursor<Postings>::npos;
+}
+
+#endif
@@ -0,0 +1,308 @@
+#ifndef __SEGMENTEDINDEX_HPP__
+#define __SEGMENTEDINDEX_HPP__
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include "darwin.hpp"
+#include "Tokenizer.hpp"
+#include "PostingList.hpp"
+#include "FileCache.hpp"
+#include "Query.hpp"
+#include "IndexBuilder.hpp"
+
+namespace Darwin {
+    // an index that is updated a document at a time. every added document is indexed
+    // into a new segment on its own, a removed one is only marked in a tombstone bitmap.
+    // doc ids are never reused and grow with every segment, so the postings of a word
+    // in doc id order are its lists of all segments one after the other.
+    // the newest segments are merged in the background once there are more than
+    // maxSegments of them, merging drops the postings of removed documents.
+    // searches may run on any thread, documents are added and removed by one thread
+    class SegmentedIndex {
+        private:
+            struct Segment {
+                InvertedIndexType index;
+                // [firstDocId, lastDocId)
+                DocIdType firstDocId;
+                DocIdType lastDocId;
+                size_t bytes = 0;
+            };
+            using SegmentPtr = shared_ptr<const Segment>;
+
+            Tokenizer _tokenizer;
+            string _dataDirectory;
+            DocumentListType _documents;
+            // filled when the segment of the document is published
+            LineOffsetListType _lineOffsets;
+            vector<bool> _deleted;
+            unordered_map<string, DocIdType> _docIds;
+            vector<SegmentPtr> _segments;
+            size_t _maxSegments;
+            mutable mutex _lock;
+
+            thread _merger;
+            bool _merging = false;
+            mutable FileCache _fileCache;
+
+        public:
+            SegmentedIndex(const string& dataDirectory, const Tokenizer& tokenizer, size_t maxSegments = 8) :
+                _tokenizer(tokenizer), _dataDirectory(dataDirectory), _maxSegments(maxSegments) {
+                if (!_dataDirectory.empty() && _dataDirectory.back() != '/') _dataDirectory += "/";
+            }
+            SegmentedIndex(const SegmentedIndex&) = delete;
+            SegmentedIndex& operator = (const SegmentedIndex&) = delete;
+            ~SegmentedIndex() {
+                waitForMerge();
+            }
+
+            // indexes every document listed in documents, in the format IndexBuilder::build
+            // reads, into one segment. names are relative to the data directory
+            void build(const string& documents) {
+                _addSegment(readDocumentList(documents));
+            }
+
+            // a document already in the index is replaced, returns its new doc id
+            DocIdType addDocument(const string& docName) {
+                return _addSegment({docName});
+            }
+
+            DocIdType updateDocument(const string& docName) {
+                return addDocument(docName);
+            }
+
+            // false if the document is not in the index
+            bool removeDocument(const string& docName) {
+                lock_guard<mutex> guard(_lock);
+                auto docId = _docIds.find(docName);
+                if (docId == _docIds.end()) return false;
+                _delete(docId->second);
+                _docIds.erase(docId);
+                _fileCache.invalidate(_dataDirectory + docName);
+                return true;
+            }
+
+            size_t documentNum() const {
+                lock_guard<mutex> guard(_lock);
+                return _docIds.size();
+            }
+
+            size_t segmentNum() const {
+                lock_guard<mutex> guard(_lock);
+                return _segments.size();
+            }
+
+            const string& dataDirectory() const { return _dataDirectory; }
+
+            // merges every segment into one now and drops every removed document
+            void merge() {
+                waitForMerge();
+                vector<SegmentPtr> segments;
+                {
+                    lock_guard<mutex> guard(_lock);
+                    segments = _segments;
+                }
+                _merge(segments);
+            }
+
+            void waitForMerge() {
+                if (_merger.joinable()) _merger.join();
+            }
+
+            SearchResultType search(const string& word) const {
+                vector<pair<string, size_t>> lines;
+                PostingVectorType postings;
+                {
+                    lock_guard<mutex> guard(_lock);
+                    postings = _postings(word);
+                    lines = _lines(postings);
+                }
+                return _fetch(postings, lines);
+            }
+
+            SearchResultType search(const Query& query) const {
+                vector<pair<string, size_t>> lines;
+                PostingVectorType postings;
+                {
+                    lock_guard<mutex> guard(_lock);
+                    postings = query.evaluateWords([this] (const string& word) { return _postings(word); });
+                    lines = _lines(postings);
+                }
+                return _fetch(postings, lines);
+            }
+
+        private:
+            // indexes docNames into a new segment outside the lock, the tokenizer is
+            // shared with searches so words are added to it under the lock. replaced
+            // documents are masked when the new segment is published, not before
+            DocIdType _addSegment(const vector<string>& docNames) {
+                DocIdType firstDocId;
+                {
+                    lock_guard<mutex> guard(_lock);
+                    if (!docNames.empty()) checkedId<DocIdType>(_documents.size() + docNames.size() - 1, "doc id");
+                    firstDocId = _documents.size();
+                    _documents.insert(_documents.end(), docNames.begin(), docNames.end());
+                    _deleted.resize(_documents.size(), false);
+                }
+
+                Tokenizer tokenizer(_tokenizer.avgWordLength());
+                InvertedIndexType partial;
+                LineOffsetListType lineOffsets(docNames.size());
+                vector<PositionType> lineLengths;
+                for (size_t i = 0; i < docNames.size(); i++) {
+                    IndexBuilder::indexDocument(firstDocId + i, _dataDirectory + docNames[i], tokenizer, partial,
+                                                lineOffsets[i], lineLengths);
+                }
+
+                auto segment = make_shared<Segment>();
+                segment->firstDocId = firstDocId;
+                segment->lastDocId = firstDocId + docNames.size();
+                bool merge;
+                {
+                    lock_guard<mutex> guard(_lock);
+                    auto wordIds = _tokenizer.merge(tokenizer);
+                    for (auto& i : partial) {
+                        segment->bytes += i.second.bytes();
+                        segment->index.emplace(wordIds[i.first], move(i.second));
+                    }
+                    _segments.push_back(segment);
+                    _lineOffsets.resize(_documents.size());
+                    for (size_t i = 0; i < docNames.size(); i++) {
+                        _lineOffsets[firstDocId + i] = move(lineOffsets[i]);
+                        auto docId = _docIds.find(docNames[i]);
+                        if (docId != _docIds.end()) _delete(docId->second);
+                        _docIds[docNames[i]] = firstDocId + i;
+                        // the file may have been replaced, not rewritten in place
+                        _fileCache.invalidate(_dataDirectory + docNames[i]);
+                    }
+                    merge = (_segments.size() > _maxSegments && !_merging);
+                    if (merge) _merging = true;
+                }
+
+                if (merge) {
+                    waitForMerge();
+                    _merger = thread([this] () {
+                        _merge(_mergeCandidates());
+                        lock_guard<mutex> guard(_lock);
+                        _merging = false;
+                    });
+                }
+                return firstDocId;
+            }
+
+            // the longest run of newest segments where no segment is larger than all the
+            // newer ones together, so every posting is merged about log(segments) times
+            vector<SegmentPtr> _mergeCandidates() const {
+                lock_guard<mutex> guard(_lock);
+                if (_segments.size() < 2) return vector<SegmentPtr>();
+                size_t first = _segments.size() - 1;
+                size_t bytes = _segments[first]->bytes;
+                while (first > 0 && _segments[first - 1]->bytes <= bytes) {
+                    first -= 1;
+                    bytes += _segments[first]->bytes;
+                }
+                if (_segments.size() - first < 2) first = _segments.size() - 2;
+                return vector<SegmentPtr>(_segments.begin() + first, _segments.end());
+            }
+
+            // replaces segments, consecutive ones, by their merge. segments added meanwhile
+            // stay after it, documents removed meanwhile are still masked by the bitmap
+            void _merge(const vector<SegmentPtr>& segments) {
+                if (segments.size() < 2 && (segments.empty() || !_hasDeleted(*segments[0]))) return;
+
+                vector<bool> deleted;
+                {
+                    lock_guard<mutex> guard(_lock);
+                    deleted = _deleted;
+                }
+
+                auto merged = make_shared<Segment>();
+                merged->firstDocId = segments.front()->firstDocId;
+                merged->lastDocId = segments.back()->lastDocId;
+                for (const auto& segment : segments) {
+                    bool clean = true;
+                    for (DocIdType docId = segment->firstDocId; docId < segment->lastDocId && clean; docId++) {
+                        clean = !deleted[docId];
+                    }
+                    for (const auto& i : segment->index) {
+                        auto& list = merged->index[i.first];
+                        if (clean) {
+                            list.append(i.second);
+                            continue;
+                        }
+                        for (const auto& p : i.second) {
+                            if (!deleted[p.docId]) list.append(p);
+                        }
+                    }
+                }
+                for (auto i = merged->index.begin(); i != merged->index.end(); ) {
+                    if (i->second.empty()) {
+                        i = merged->index.erase(i);
+                        continue;
+                    }
+                    i->second.shrink_to_fit();
+                    merged->bytes += i->second.bytes();
+                    ++i;
+                }
+
+                lock_guard<mutex> guard(_lock);
+                size_t first = find(_segments.begin(), _segments.end(), segments.front()) - _segments.begin();
+                _segments.erase(_segments.begin() + first, _segments.begin() + first + segments.size());
+                _segments.insert(_segments.begin() + first, merged);
+            }
+
+            // masks docId and frees its name and line table, searches skip it before reading
+            // either. called with the lock held
+            void _delete(DocIdType docId) {
+                _deleted[docId] = true;
+                string().swap(_documents[docId]);
+                _lineOffsets[docId] = LineOffsetTable();
+            }
+
+            bool _hasDeleted(const Segment& segment) const {
+                lock_guard<mutex> guard(_lock);
+                for (DocIdType docId = segment.firstDocId; docId < segment.lastDocId; docId++) {
+                    if (_deleted[docId]) return true;
+                }
+                return false;
+            }
+
+            // called with the lock held
+            PostingVectorType _postings(StringRef word) const {
+                PostingVectorType ret;
+                WordIdType wordId = _tokenizer.getWordId(word);
+                if (wordId == 0) return ret;
+                for (const auto& segment : _segments) {
+                    auto docs = segment->index.find(wordId);
+                    if (docs == segment->index.end()) continue;
+                    for (const auto& p : docs->second) {
+                        if (!_deleted[p.docId]) ret.push_back(p);
+                    }
+                }
+                return ret;
+            }
+
+            // the document name and line offset of every posting, called with the lock held
+            vector<pair<string, size_t>> _lines(const PostingVectorType& postings) const {
+                vector<pair<string, size_t>> ret;
+                ret.reserve(postings.size());
+                for (const auto& p : postings) ret.emplace_back(_documents[p.docId], _lineOffsets[p.docId][p.lineno]);
+                return ret;
+            }
+
+            SearchResultType _fetch(const PostingVectorType& postings, const vector<pair<string, size_t>>& lines) const {
+                SearchResultType result;
+                for (size_t i = 0; i < postings.size(); i++) {
+                    const auto& doc = postings[i];
+                    string lineContent = _fileCache.readLine(_dataDirectory + lines[i].first, lines[i].second);
+                    result.push_back(Result(doc.docId, lines[i].first, doc.lineno, lineContent));
+                }
+                return result;
+            }
+    };
+}
+
+#endif
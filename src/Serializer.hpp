@@ -8,7 +8,9 @@
 #include <fstream>
 #include <algorithm>
 #include <exception>
+#include <type_traits>
 #include "darwin.hpp"
+#include "ByteStream.hpp"
 
 using namespace std;
 namespace Darwin {
@@ -23,6 +25,39 @@ namespace Darwin {
             }
     };
 
+    class IdWidthMismatch : public exception {
+        private:
+            string _message;
+        public:
+            IdWidthMismatch(const string& message) : _message(message) {}
+            virtual const char* what() const noexcept override {
+                return _message.c_str();
+            }
+    };
+
+    // the byte widths of the ids of DefaultIdTraits, written ahead of an index so a
+    // build with other widths refuses the file instead of misreading it
+    struct IdWidths {
+        uint8_t wordId = sizeof(WordIdType);
+        uint8_t docId = sizeof(DocIdType);
+        uint8_t position = sizeof(PositionType);
+
+        bool operator == (const IdWidths& rhs) const {
+            return wordId == rhs.wordId && docId == rhs.docId && position == rhs.position;
+        }
+        bool operator != (const IdWidths& rhs) const {
+            return !(*this == rhs);
+        }
+        string str() const {
+            return to_string(wordId) + "/" + to_string(docId) + "/" + to_string(position);
+        }
+    };
+
+    // types whose SerializeFunc writes exactly their in-memory bytes, so vectors of them
+    // are written and read as one block. opt in by specializing for types with no padding
+    template <typename T>
+    struct IsBulkSerializable : integral_constant<bool, is_arithmetic<T>::value && !is_same<T, bool>::value> {};
+
     template <typename T>
     struct SerializeFunc;
     template <typename T>
@@ -70,7 +105,7 @@ namespace Darwin {
     // basic template
     template <typename T>
     struct SerializeFunc {
-        void operator () (ofstream& fout, const T& data) const {
+        void operator () (ByteSink& fout, const T& data) const {
             fout.write((reinterpret_cast<const char*>(&data)), sizeof(data));
         }
     };
@@ -78,7 +113,7 @@ namespace Darwin {
     // basic const T template
     template <typename T>
     struct SerializeFunc<const T> {
-        void operator () (ofstream& fout, const T& data) const {
+        void operator () (ByteSink& fout, const T& data) const {
             SerializeFunc<T>()(fout, data);
         }
     };
@@ -86,7 +121,7 @@ namespace Darwin {
     // basic template for DeserializeFunc
     template <typename T>
     struct DeserializeFunc {
-        void operator () (ifstream& fin, T& data) const {
+        void operator () (ByteSource& fin, T& data) const {
             fin.read((reinterpret_cast<char*>(&data)), sizeof(data));
         }
     };
@@ -94,7 +129,7 @@ namespace Darwin {
     // T* SerializeFunc
     template <typename T>
     struct SerializeFunc<T*> {
-        void operator () (ofstream& fout, const T* data, size_t length) const {
+        void operator () (ByteSink& fout, const T* data, size_t length) const {
             fout.write((reinterpret_cast<const char*>(data)), sizeof(const char) * length);
         }
     };
@@ -102,7 +137,7 @@ namespace Darwin {
     // string SerializeFunc
     template <>
     struct SerializeFunc<string> {
-        void operator () (ofstream& fout, const string& data) const {
+        void operator () (ByteSink& fout, const string& data) const {
             SerializeFunc<typename string::size_type>()(fout, data.length());
             SerializeFunc<typename string::pointer>()(fout, data.c_str(), data.length());
         }
@@ -111,7 +146,7 @@ namespace Darwin {
     // pair SerializeFunc
     template <typename FirstType, typename SecondType>
     struct SerializeFunc<pair<FirstType, SecondType>> {
-        void operator () (ofstream& fout, const pair<FirstType, SecondType>& data) const {
+        void operator () (ByteSink& fout, const pair<FirstType, SecondType>& data) const {
             SerializeFunc<FirstType>()(fout, data.first);
             SerializeFunc<SecondType>()(fout, data.second);
         }
@@ -120,7 +155,7 @@ namespace Darwin {
     // unordered_set SerializeFunc
     template <typename Key, typename Hash, typename Pred, typename Alloc>
     struct SerializeFunc<unordered_set<Key, Hash, Pred, Alloc>> {
-        void operator () (ofstream& fout, const unordered_set<Key, Hash, Pred, Alloc>& data) const {
+        void operator () (ByteSink& fout, const unordered_set<Key, Hash, Pred, Alloc>& data) const {
             using size_type = typename unordered_set<Key, Hash, Pred, Alloc>::size_type;
             using value_type = typename unordered_set<Key, Hash, Pred, Alloc>::value_type;
 
@@ -134,7 +169,7 @@ namespace Darwin {
     // unordered_map SerializeFunc
     template <typename Key, typename T, typename Hash, typename Pred, typename Alloc>
     struct SerializeFunc<unordered_map<Key, T, Hash, Pred, Alloc>> {
-        void operator () (ofstream& fout, const unordered_map<Key, T, Hash, Pred, Alloc>& data) const {
+        void operator () (ByteSink& fout, const unordered_map<Key, T, Hash, Pred, Alloc>& data) const {
             using size_type = typename unordered_map<Key, T, Hash, Pred, Alloc>::size_type;
             using value_type = typename unordered_map<Key, T, Hash, Pred, Alloc>::value_type;
 
@@ -148,21 +183,31 @@ namespace Darwin {
     // vector SerializeFunc
     template <typename T, typename Alloc>
     struct SerializeFunc<vector<T, Alloc>> {
-        void operator () (ofstream& fout, const vector<T, Alloc>& data) const {
+        void operator () (ByteSink& fout, const vector<T, Alloc>& data) const {
             using size_type = typename vector<T, Alloc>::size_type;
             using value_type = typename vector<T, Alloc>::value_type;
 
             SerializeFunc<size_type>()(fout, data.size());
-            for (const auto & d : data) {
-                SerializeFunc<value_type>()(fout, d);
-            }
+            _write(fout, data, IsBulkSerializable<value_type>());
         }
+
+        private:
+            void _write(ByteSink& fout, const vector<T, Alloc>& data, true_type) const {
+                static_assert(is_trivially_copyable<T>::value, "bulk serialization needs a trivially copyable type");
+                fout.write(reinterpret_cast<const char*>(data.data()), data.size() * sizeof(T));
+            }
+
+            void _write(ByteSink& fout, const vector<T, Alloc>& data, false_type) const {
+                for (const auto & d : data) {
+                    SerializeFunc<T>()(fout, d);
+                }
+            }
     };
 
     // T* DeserializeFunc
     template <typename T>
     struct DeserializeFunc<T*> {
-        void operator () (ifstream& fin, T* data, size_t length) const {
+        void operator () (ByteSource& fin, T* data, size_t length) const {
             fin.read((reinterpret_cast<char*>(data)), length * sizeof(T));
         }
     };
@@ -170,30 +215,22 @@ namespace Darwin {
     // string DeserializeFunc
     template <>
     struct DeserializeFunc<string> {
-        void operator () (ifstream& fin, string& data) const {
+        void operator () (ByteSource& fin, string& data) const {
             using size_type = typename string::size_type;
-            using value_type = typename string::value_type;
             using pointer = typename string::pointer;
 
             size_type size;
             DeserializeFunc<size_type>()(fin, size);
 
-            pointer tmp = new value_type [size+1];
-            DeserializeFunc<pointer>()(fin, tmp, size);
-            tmp[size] = '\0';
-
-            data.clear();
-            data.reserve(size);
-            data.append(tmp);
-
-            delete [] tmp;
+            data.resize(size);
+            if (size != 0) DeserializeFunc<pointer>()(fin, &data[0], size);
         }
     };
 
     // pair DeserializeFunc
     template <typename FirstType, typename SecondType>
     struct DeserializeFunc<pair<FirstType, SecondType>> {
-        void operator () (ifstream& fin, pair<FirstType, SecondType>& data) const {
+        void operator () (ByteSource& fin, pair<FirstType, SecondType>& data) const {
             DeserializeFunc<FirstType>()(fin, data.first);
             DeserializeFunc<SecondType>()(fin, data.second);
         }
@@ -202,7 +239,7 @@ namespace Darwin {
     // unordered_set DeserializeFunc 
     template <typename Key, typename Hash, typename Pred, typename Alloc>
     struct DeserializeFunc<unordered_set<Key, Hash, Pred, Alloc>> {
-        void operator () (ifstream& fin, unordered_set<Key, Hash, Pred, Alloc>& data) const {
+        void operator () (ByteSource& fin, unordered_set<Key, Hash, Pred, Alloc>& data) const {
             using size_type = typename unordered_set<Key, Hash, Pred, Alloc>::size_type;
 
             size_type size;
@@ -222,7 +259,7 @@ namespace Darwin {
     // unordered_map DeserializeFunc
     template <typename Key, typename T, typename Hash, typename Pred, typename Alloc>
     struct DeserializeFunc<unordered_map<Key, T, Hash, Pred, Alloc>> {
-        void operator () (ifstream& fin, unordered_map<Key, T, Hash, Pred, Alloc>& data) const {
+        void operator () (ByteSource& fin, unordered_map<Key, T, Hash, Pred, Alloc>& data) const {
             using size_type = typename unordered_map<Key, T, Hash, Pred, Alloc>::size_type;
 
             size_type size;
@@ -242,7 +279,7 @@ namespace Darwin {
     // vector DeserializeFunc
     template <typename T, typename Alloc>
     struct DeserializeFunc<vector<T, Alloc>> {
-        void operator () (ifstream& fin, vector<T, Alloc>& data) const {
+        void operator () (ByteSource& fin, vector<T, Alloc>& data) const {
             using size_type = typename vector<T, Alloc>::size_type;
             using value_type = typename vector<T, Alloc>::value_type;
 
@@ -250,12 +287,44 @@ namespace Darwin {
             DeserializeFunc<size_type>()(fin, size);
 
             data.clear();
-            data.reserve(size);
+            _read(fin, data, size, IsBulkSerializable<value_type>());
+        }
 
-            for (size_type i = 0; i < size; i++) {
-                value_type val;
-                DeserializeFunc<value_type>()(fin, val);
-                data.push_back(val);
+        private:
+            void _read(ByteSource& fin, vector<T, Alloc>& data, size_t size, true_type) const {
+                static_assert(is_trivially_copyable<T>::value, "bulk serialization needs a trivially copyable type");
+                data.resize(size);
+                fin.read(reinterpret_cast<char*>(data.data()), size * sizeof(T));
+            }
+
+            void _read(ByteSource& fin, vector<T, Alloc>& data, size_t size, false_type) const {
+                data.reserve(size);
+                for (size_t i = 0; i < size; i++) {
+                    T val;
+                    DeserializeFunc<T>()(fin, val);
+                    data.push_back(val);
+                }
+            }
+    };
+
+    template <>
+    struct SerializeFunc<IdWidths> {
+        void operator () (ByteSink& fout, const IdWidths& widths) const {
+            SerializeFunc<uint8_t>()(fout, widths.wordId);
+            SerializeFunc<uint8_t>()(fout, widths.docId);
+            SerializeFunc<uint8_t>()(fout, widths.position);
+        }
+    };
+
+    // throws unless the widths read are the ones of this build
+    template <>
+    struct DeserializeFunc<IdWidths> {
+        void operator () (ByteSource& fin, IdWidths& widths) const {
+            DeserializeFunc<uint8_t>()(fin, widths.wordId);
+            DeserializeFunc<uint8_t>()(fin, widths.docId);
+            DeserializeFunc<uint8_t>()(fin, widths.position);
+            if (widths != IdWidths()) {
+                throw IdWidthMismatch("index ids are " + widths.str() + " bytes wide, this build reads " + IdWidths().str());
             }
         }
     };
@@ -266,26 +335,36 @@ namespace Darwin {
         public:
             template <typename T, typename Func = SerializeFunc<T>>
             void serialize(const string& dumpFileName, const T& data, const Func& func = Func()) {
-                ofstream fout(dumpFileName, ios_base::out | ios_base::binary);
-                serialize(fout, data, func);
-                fout.close();
+                FileSink sink(dumpFileName);
+                serialize(sink, data, func);
             }
 
             template <typename T, typename Func = DeserializeFunc<T>>
             void deserialize(const string& backupFileName, T& data, const Func& func = Func()) {
-                ifstream fin(backupFileName, ios_base::in | ios_base::binary);
-                deserialize(fin, data, func);
-                fin.close();
+                FileSource source(backupFileName);
+                deserialize(source, data, func);
             }
 
             template <typename T, typename Func = SerializeFunc<T>>
             void serialize(ofstream& fout, const T& data, const Func& func = Func()) {
-                func(fout, data);
+                StreamSink sink(fout);
+                serialize(sink, data, func);
             }
 
             template <typename T, typename Func = DeserializeFunc<T>>
             void deserialize(ifstream& fin, T& data, const Func& func = Func()) {
-                func(fin, data);
+                StreamSource source(fin);
+                deserialize(source, data, func);
+            }
+
+            template <typename T, typename Func = SerializeFunc<T>>
+            void serialize(ByteSink& sink, const T& data, const Func& func = Func()) {
+                func(sink, data);
+            }
+
+            template <typename T, typename Func = DeserializeFunc<T>>
+            void deserialize(ByteSource& source, T& data, const Func& func = Func()) {
+                func(source, data);
             }
     };
 
@@ -0,0 +1,261 @@
+#ifndef __TERMDICTIONARY_HPP__
+#define __TERMDICTIONARY_HPP__
+
+#include <string>
+#include <vector>
+#include <utility>
+#include <algorithm>
+#include "darwin.hpp"
+#include "PostingList.hpp"
+#include "LevenshteinAutomaton.hpp"
+
+namespace Darwin {
+    // the words of a tokenizer in byte order, front coded in blocks of _blockSize: the
+    // first word of a block is stored whole, every other one as the length of the prefix
+    // it shares with the word before it and the bytes after that. a word is found by a
+    // binary search over the first words of the blocks and a scan of one block, so prefix
+    // and wildcard patterns are expanded without going through the whole vocabulary.
+    // word ids are handed out in the order words are first seen, not in byte order, so
+    // the id of every word is kept next to the blocks. fuzzy words are found by running
+    // a LevenshteinAutomaton over the words in order
+    class TermDictionary {
+        private:
+            static const size_t _blockSize = 16;
+
+            vector<unsigned char> _data;
+            // block b starts at _data[_blockOffsets[b]]
+            vector<size_t> _blockOffsets;
+            // the id of the word at every position
+            vector<WordIdType> _ids;
+
+            // decodes the words of the dictionary one after the other
+            class Reader {
+                private:
+                    const TermDictionary& _terms;
+                    const unsigned char* _pos = nullptr;
+                    size_t _next = 0;
+
+                public:
+                    string word;
+
+                    Reader(const TermDictionary& terms, size_t block) :
+                        _terms(terms), _next(block * _blockSize) {
+                        if (block < terms._blockOffsets.size()) _pos = terms._data.data() + terms._blockOffsets[block];
+                    }
+
+                    // the position of the word read last
+                    size_t pos() const { return _next - 1; }
+
+                    // false after the last word
+                    bool next() {
+                        if (_next == _terms.size()) return false;
+                        size_t shared = (_next % _blockSize == 0 ? 0 : VarByte::decode(_pos));
+                        size_t length = VarByte::decode(_pos);
+                        word.resize(shared);
+                        word.append(reinterpret_cast<const char*>(_pos), length);
+                        _pos += length;
+                        _next += 1;
+                        return true;
+                    }
+            };
+
+        public:
+            TermDictionary() {}
+
+            template <typename Tokenizer>
+            explicit TermDictionary(const Tokenizer& tokenizer) {
+                vector<pair<StringRef, WordIdType>> words;
+                words.reserve(tokenizer.wordNum());
+                tokenizer.forEachWord([&words] (StringRef word, WordIdType wordId) {
+                    words.push_back(make_pair(word, wordId));
+                });
+                sort(words.begin(), words.end(), [] (const pair<StringRef, WordIdType>& lhs, const pair<StringRef, WordIdType>& rhs) {
+                    return lhs.first.compare(rhs.first) < 0;
+                });
+
+                _ids.reserve(words.size());
+                _blockOffsets.reserve((words.size() + _blockSize - 1) / _blockSize);
+                StringRef last;
+                for (size_t i = 0; i < words.size(); i++) {
+                    StringRef word = words[i].first;
+                    size_t shared = 0;
+                    if (i % _blockSize == 0) {
+                        _blockOffsets.push_back(_data.size());
+                    } else {
+                        while (shared < last.length() && shared < word.length() && last[shared] == word[shared]) shared++;
+                        VarByte::encode(_data, shared);
+                    }
+                    VarByte::encode(_data, word.length() - shared);
+                    _data.insert(_data.end(), word.data() + shared, word.data() + word.length());
+                    _ids.push_back(words[i].second);
+                    last = word;
+                }
+                _data.shrink_to_fit();
+            }
+
+            size_t size() const { return _ids.size(); }
+            bool empty() const { return _ids.empty(); }
+
+            // bytes held by the dictionary
+            size_t bytes() const {
+                return _data.capacity() + _blockOffsets.capacity() * sizeof(size_t) + _ids.capacity() * sizeof(WordIdType);
+            }
+
+            string word(size_t pos) const {
+                Reader reader(*this, pos / _blockSize);
+                while (reader.next() && reader.pos() < pos) {}
+                return reader.word;
+            }
+
+            WordIdType wordId(size_t pos) const { return _ids[pos]; }
+
+            // the position of the first word not less than word, size() if there is none
+            size_t lowerBound(StringRef word) const {
+                // the last block whose first word is not greater than word
+                size_t first = 0;
+                size_t last = _blockOffsets.size();
+                while (first < last) {
+                    size_t mid = first + (last - first) / 2;
+                    if (_firstWord(mid).compare(word) <= 0) {
+                        first = mid + 1;
+                    } else {
+                        last = mid;
+                    }
+                }
+                if (first == 0) return 0;
+
+                Reader reader(*this, first - 1);
+                while (reader.next()) {
+                    if (StringRef(reader.word).compare(word) >= 0) return reader.pos();
+                }
+                return size();
+            }
+
+            // calls func(word, wordId) for the words from position pos on, in order,
+            // as long as it returns true
+            template <typename Func>
+            void forEachFrom(size_t pos, Func func) const {
+                Reader reader(*this, pos / _blockSize);
+                while (reader.next()) {
+                    if (reader.pos() < pos) continue;
+                    if (!func(StringRef(reader.word), _ids[reader.pos()])) return;
+                }
+            }
+
+            // calls func(word, wordId) for every word starting with prefix, in order
+            template <typename Func>
+            void forEachPrefix(StringRef prefix, Func func) const {
+                forEachFrom(lowerBound(prefix), [&prefix, &func] (StringRef word, WordIdType wordId) {
+                    if (!_startsWith(word, prefix)) return false;
+                    func(word, wordId);
+                    return true;
+                });
+            }
+
+            // the ids of the words matching pattern, where * stands for any run of bytes and
+            // ? for a single one. only the words sharing the bytes before the first wildcard
+            // are looked at, a pattern starting with a wildcard goes through every word
+            vector<WordIdType> expand(const string& pattern) const {
+                vector<WordIdType> ret;
+                size_t literal = pattern.find_first_of("*?");
+                if (literal == string::npos) {
+                    size_t pos = lowerBound(pattern);
+                    if (pos != size() && word(pos) == pattern) ret.push_back(_ids[pos]);
+                    return ret;
+                }
+                StringRef prefix(pattern.data(), literal);
+                forEachPrefix(prefix, [&pattern, &ret] (StringRef word, WordIdType wordId) {
+                    if (match(pattern, word)) ret.push_back(wordId);
+                });
+                return ret;
+            }
+
+            // calls func(word, wordId, distance) for every word within maxDistance edits of
+            // word, in order. the automaton is run over the words sharing a prefix once, and
+            // once no word with a prefix can match the walk seeks past all of them
+            template <typename Func>
+            void forEachFuzzy(StringRef word, size_t maxDistance, Func func) const {
+                LevenshteinAutomaton automaton(word, maxDistance);
+                // states[i] is the state after the first i bytes of prefix
+                vector<LevenshteinAutomaton::State> states = {automaton.start()};
+                string prefix;
+                size_t pos = 0;
+                while (pos < size()) {
+                    Reader reader(*this, pos / _blockSize);
+                    size_t next = size();
+                    while (reader.next()) {
+                        if (reader.pos() < pos) continue;
+                        const string& term = reader.word;
+                        size_t shared = 0;
+                        while (shared < prefix.length() && shared < term.length() && prefix[shared] == term[shared]) shared++;
+                        states.resize(shared + 1);
+                        while (states.size() <= term.length() && automaton.canMatch(states.back())) {
+                            states.push_back(automaton.step(states.back(), term[states.size() - 1]));
+                        }
+                        prefix.assign(term, 0, states.size() - 1);
+
+                        if (automaton.canMatch(states.back())) {
+                            if (automaton.isMatch(states.back())) func(StringRef(term), _ids[reader.pos()], automaton.distance(states.back()));
+                            continue;
+                        }
+                        // no word starting with prefix can match, go on after the last of them
+                        string successor = prefix;
+                        while (!successor.empty() && static_cast<unsigned char>(successor.back()) == 0xff) successor.pop_back();
+                        if (!successor.empty()) {
+                            successor.back() = static_cast<char>(static_cast<unsigned char>(successor.back()) + 1);
+                            next = lowerBound(successor);
+                        }
+                        break;
+                    }
+                    pos = next;
+                }
+            }
+
+            // the ids of the words within maxDistance edits of word
+            vector<WordIdType> fuzzy(StringRef word, size_t maxDistance) const {
+                vector<WordIdType> ret;
+                forEachFuzzy(word, maxDistance, [&ret] (StringRef, WordIdType wordId, size_t) {
+                    ret.push_back(wordId);
+                });
+                return ret;
+            }
+
+            // whether all of word matches pattern, see expand
+            static bool match(StringRef pattern, StringRef word) {
+                size_t p = 0;
+                size_t w = 0;
+                // where the last * was and the word position it has been tried up to
+                size_t star = string::npos;
+                size_t starWord = 0;
+                while (w < word.length()) {
+                    if (p < pattern.length() && (pattern[p] == '?' || pattern[p] == word[w])) {
+                        p++;
+                        w++;
+                    } else if (p < pattern.length() && pattern[p] == '*') {
+                        star = p++;
+                        starWord = w;
+                    } else if (star != string::npos) {
+                        p = star + 1;
+                        w = ++starWord;
+                    } else {
+                        return false;
+                    }
+                }
+                while (p < pattern.length() && pattern[p] == '*') p++;
+                return p == pattern.length();
+            }
+
+        private:
+            StringRef _firstWord(size_t block) const {
+                const unsigned char* pos = _data.data() + _blockOffsets[block];
+                size_t length = VarByte::decode(pos);
+                return StringRef(reinterpret_cast<const char*>(pos), length);
+            }
+
+            static bool _startsWith(StringRef word, StringRef prefix) {
+                return word.length() >= prefix.length() && StringRef(word.data(), prefix.length()) == prefix;
+            }
+    };
+}
+
+#endif
@@ -6,43 +6,152 @@
 #include <string>
 #include <fstream>
 #include <algorithm>
+#include <memory>
+#include <functional>
+#include <initializer_list>
 #include "darwin.hpp"
+#include "Arena.hpp"
 #include "Serializer.hpp"
+#include "DelimiterSet.hpp"
 
 namespace Darwin {
-    using WordMapType = unordered_map<string, WordIdType>;
+    // word -> id map that is looked up by StringRef, a word is only copied when inserted.
+    // the bytes of the words are bump allocated from an arena owned by the dictionary, so
+    // they take no allocation each and are freed in a few blocks. the map itself stays on
+    // the default allocator: a rehash gives its old bucket array back, which an arena
+    // cannot take, and the number of words is rarely known ahead to reserve for
+    class WordDictionary {
+        private:
+            using MapType = unordered_map<StringRef, WordIdType, StringRefHash>;
+            // the arena is declared first so it outlives the map. it is held by pointer
+            // so the words keep their address when the dictionary is moved
+            unique_ptr<Arena> _arena;
+            MapType _ids;
+
+        public:
+            using key_type = StringRef;
+            using mapped_type = WordIdType;
+            using value_type = MapType::value_type;
+            using size_type = MapType::size_type;
+            using const_iterator = MapType::const_iterator;
+            using iterator = MapType::const_iterator;
+
+            WordDictionary() :
+                _arena(new Arena()) {}
+            WordDictionary(initializer_list<pair<string, WordIdType>> words) : WordDictionary() {
+                for (const auto& w : words) insert(w.first, w.second);
+            }
+            WordDictionary(const WordDictionary& rhs) : WordDictionary() {
+                _ids.reserve(rhs.size());
+                for (const auto& w : rhs) insert(w.first, w.second);
+            }
+            WordDictionary(WordDictionary&& rhs) : WordDictionary() {
+                swap(rhs);
+            }
+            WordDictionary& operator = (const WordDictionary& rhs) {
+                if (this == &rhs) return *this;
+                WordDictionary(rhs).swap(*this);
+                return *this;
+            }
+            WordDictionary& operator = (WordDictionary&& rhs) {
+                swap(rhs);
+                return *this;
+            }
+
+            void swap(WordDictionary& rhs) {
+                _arena.swap(rhs._arena);
+                _ids.swap(rhs._ids);
+            }
+
+            const_iterator find(StringRef word) const { return _ids.find(word); }
+            const_iterator begin() const { return _ids.begin(); }
+            const_iterator end() const { return _ids.end(); }
+            size_type size() const { return _ids.size(); }
+            void reserve(size_type size) { _ids.reserve(size); }
+
+            // also gives the memory of the words back
+            void clear() {
+                WordDictionary().swap(*this);
+            }
+
+            // word must not be in the map yet
+            void insert(StringRef word, WordIdType wordId) {
+                _ids.insert(make_pair(_arena->copy(word), wordId));
+            }
+
+            // bytes reserved for the words
+            size_t arenaBytes() const { return _arena->capacity(); }
+
+            bool operator == (const WordDictionary& rhs) const { return _ids == rhs._ids; }
+            bool operator != (const WordDictionary& rhs) const { return _ids != rhs._ids; }
+    };
+
+    using WordMapType = WordDictionary;
 
     template <>
     struct SerializeFunc<WordMapType> {
-        void operator () (ofstream& fout, const WordMapType& wordMap) {
+        void operator () (ByteSink& fout, const WordMapType& wordMap) {
             SerializeFunc<WordMapType::size_type>()(fout, wordMap.size());
             for (const auto & d : wordMap) {
-                SerializeFunc<WordMapType::value_type>()(fout, d);
+                SerializeFunc<string>()(fout, d.first.str());
+                SerializeFunc<WordMapType::mapped_type>()(fout, d.second);
             }
         }
     };
 
     template <>
     struct DeserializeFunc<WordMapType> {
-        void operator () (ifstream& fin, WordMapType& data) const {
+        void operator () (ByteSource& fin, WordMapType& data) const {
             typename WordMapType::size_type size;
             DeserializeFunc<typename WordMapType::size_type>()(fin, size);
 
-            pair<WordMapType::key_type, WordMapType::mapped_type> val;
+            data.clear();
+            data.reserve(size);
+
+            pair<string, WordMapType::mapped_type> val;
             for (typename WordMapType::size_type i = 0; i < size; i++) {
-                DeserializeFunc<pair<WordMapType::key_type, WordMapType::mapped_type>>()(fin, val);
-                data.insert(val);
+                DeserializeFunc<pair<string, WordMapType::mapped_type>>()(fin, val);
+                data.insert(val.first, val.second);
+            }
+        }
+    };
+
+    // dictionary operations the tokenizer is written against
+    template <typename WordMap>
+    struct WordMapOps;
+
+    template <>
+    struct WordMapOps<WordMapType> {
+        static WordIdType find(const WordMapType& wordMap, StringRef word) {
+            auto wordInfo = wordMap.find(word);
+            if (wordInfo == wordMap.end()) return 0;
+            return wordInfo->second;
+        }
+
+        static WordIdType insert(WordMapType& wordMap, StringRef word) {
+            auto wordInfo = wordMap.find(word);
+            if (wordInfo != wordMap.end()) return wordInfo->second;
+
+            auto wordId = checkedId<WordIdType>(wordMap.size() + 1, "word id");
+            wordMap.insert(word, wordId);
+            return wordId;
+        }
+
+        template <typename Func>
+        static void forEach(const WordMapType& wordMap, Func func) {
+            for (const auto& w : wordMap) {
+                func(w.first, w.second);
             }
         }
     };
 
-    template <typename Validator>
+    template <typename Validator, typename WordMap = WordMapType>
     class TokenizerT;
 
-    template <typename Validator>
-    bool operator == (const TokenizerT<Validator>& t1, const TokenizerT<Validator>& t2);
+    template <typename Validator, typename WordMap>
+    bool operator == (const TokenizerT<Validator, WordMap>& t1, const TokenizerT<Validator, WordMap>& t2);
 
-    template <typename Validator>
+    template <typename Validator, typename WordMap>
     class TokenizerT {
         friend Validator;
         friend SerializeFunc<TokenizerT>;
@@ -51,7 +160,7 @@ namespace Darwin {
 
         private:
             size_t _avgWordLength = 5;
-            WordMapType _wordMap;
+            WordMap _wordMap;
         public:
             explicit TokenizerT(size_t avgWordLength = 5) :
                 _avgWordLength(avgWordLength) {}
@@ -72,75 +181,109 @@ namespace Darwin {
                 return *this;
             }
 
-            WordIdType getWordId(const string& word) const {
-                auto wordInfo = _wordMap.find(word);
-                if (wordInfo == _wordMap.end()) return 0;
-                return wordInfo->second;
+            size_t avgWordLength() const {
+                return _avgWordLength;
+            }
+
+            size_t wordNum() const {
+                return _wordMap.size();
+            }
+
+            // calls func(word, wordId) for every known word, in no particular order
+            template <typename Func>
+            void forEachWord(Func func) const {
+                WordMapOps<WordMap>::forEach(_wordMap, func);
+            }
+
+            WordIdType getWordId(StringRef word) const {
+                return WordMapOps<WordMap>::find(_wordMap, word);
             }
 
             vector<string> split(const string& sentence, const string& delims = " ") const {
                 vector<string> words;
-                auto length = sentence.length();
-                words.reserve(length / _avgWordLength);
-
-                decltype(length) pos = 0, lastPos = 0;
-                while (pos != length) {
-                    pos = sentence.find_first_of(delims, lastPos);
-                    if (pos == string::npos) pos = length;
-                    if (pos != lastPos) words.push_back(string(sentence.data()+lastPos, pos-lastPos));
-                    lastPos = pos + 1;
+                for (const auto& word : splitRef(sentence, DelimiterSet(delims))) {
+                    words.push_back(word.str());
                 }
+                return words;
+            }
 
+            // the words point into sentence, which has to outlive them
+            vector<StringRef> splitRef(StringRef sentence, const string& delims = " ") const {
+                return splitRef(sentence, DelimiterSet(delims));
+            }
+
+            vector<StringRef> splitRef(StringRef sentence, const DelimiterSet& delims) const {
+                vector<StringRef> words;
+                words.reserve(sentence.length() / _avgWordLength);
+
+                const char* data = sentence.data();
+                delims.forEachToken(data, sentence.length(), [&words, data] (size_t begin, size_t end) {
+                    words.push_back(StringRef(data+begin, end-begin));
+                });
                 return words;
             }
 
-            vector<WordIdType> tokenize(const string& sentence, const string& delims = " ") {
-                auto words = split(sentence, delims);
+            vector<WordIdType> tokenize(StringRef sentence, const string& delims = " ") {
+                return tokenize(sentence, DelimiterSet(delims));
+            }
+
+            vector<WordIdType> tokenize(StringRef sentence, const DelimiterSet& delims) {
                 vector<WordIdType> ret;
-                for (const auto& word : words) {
+                for (const auto& word : splitRef(sentence, delims)) {
                     ret.push_back(_update(word));
                 }
                 return ret;
             }
 
-        private:
+            // adds the words of rhs in the order rhs assigned their ids, so merging
+            // tokenizers of consecutive document ranges gives the ids of a single pass.
+            // returns the mapping from rhs word ids to ids of this tokenizer
+            vector<WordIdType> merge(const TokenizerT& rhs) {
+                vector<StringRef> words(rhs._wordMap.size() + 1);
+                WordMapOps<WordMap>::forEach(rhs._wordMap, [&words] (StringRef word, WordIdType wordId) {
+                    words[wordId] = word;
+                });
+
+                vector<WordIdType> ids(words.size(), 0);
+                for (size_t i = 1; i < words.size(); i++) {
+                    ids[i] = _update(words[i]);
+                }
+                return ids;
+            }
 
-            WordIdType _update(const string& word) {
-                auto wordInfo = _wordMap.find(word);
-                if (wordInfo != _wordMap.end()) return wordInfo->second; 
+        private:
 
-                auto wordId = _wordMap.size();
-                _wordMap.insert(make_pair(word, wordId+1));
-                return (wordId+1);
+            WordIdType _update(StringRef word) {
+                return WordMapOps<WordMap>::insert(_wordMap, word);
             }
             
     };
 
-    template <typename Validator>
-    struct SerializeFunc<TokenizerT<Validator>> {
-        void operator () (ofstream& fout, const TokenizerT<Validator>& tokenizer) const {
+    template <typename Validator, typename WordMap>
+    struct SerializeFunc<TokenizerT<Validator, WordMap>> {
+        void operator () (ByteSink& fout, const TokenizerT<Validator, WordMap>& tokenizer) const {
             SerializeFunc<size_t>()(fout, tokenizer._avgWordLength);
-            SerializeFunc<WordMapType>()(fout, tokenizer._wordMap);
+            SerializeFunc<WordMap>()(fout, tokenizer._wordMap);
         }
     };
 
-    template <typename Validator>
-    struct DeserializeFunc<TokenizerT<Validator>> {
-        void operator () (ifstream& fin, TokenizerT<Validator>& tokenizer) const {
+    template <typename Validator, typename WordMap>
+    struct DeserializeFunc<TokenizerT<Validator, WordMap>> {
+        void operator () (ByteSource& fin, TokenizerT<Validator, WordMap>& tokenizer) const {
             DeserializeFunc<size_t>()(fin, tokenizer._avgWordLength);
-            DeserializeFunc<WordMapType>()(fin, tokenizer._wordMap);
+            DeserializeFunc<WordMap>()(fin, tokenizer._wordMap);
         }
     };
 
-    template<typename Validator>
-    inline bool operator == (const TokenizerT<Validator>& lhs, const TokenizerT<Validator>& rhs) {
+    template<typename Validator, typename WordMap>
+    inline bool operator == (const TokenizerT<Validator, WordMap>& lhs, const TokenizerT<Validator, WordMap>& rhs) {
         if (lhs._avgWordLength != rhs._avgWordLength) return false;
         if (lhs._wordMap != rhs._wordMap) return false;
         return true;
     }
 
-    template<typename Validator>
-    inline bool operator != (const TokenizerT<Validator>& lhs, const TokenizerT<Validator>& rhs) {
+    template<typename Validator, typename WordMap>
+    inline bool operator != (const TokenizerT<Validator, WordMap>& lhs, const TokenizerT<Validator, WordMap>& rhs) {
         return (!(lhs == rhs));
     }
 
@@ -0,0 +1,205 @@
+#ifndef __TRIGRAMINDEX_HPP__
+#define __TRIGRAMINDEX_HPP__
+
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <algorithm>
+#include <cstdint>
+#include <cctype>
+#include "darwin.hpp"
+#include "Serializer.hpp"
+#include "PostingList.hpp"
+#include "Query.hpp"
+
+namespace Darwin {
+    // lines by every three consecutive bytes they contain. a line holding a string of
+    // three bytes or more holds all its trigrams, so intersecting their lists gives a
+    // superset of the lines with the string. candidates still have to be checked
+    class TrigramIndex {
+        friend SerializeFunc<TrigramIndex>;
+        friend DeserializeFunc<TrigramIndex>;
+
+        private:
+            using MapType = unordered_map<uint32_t, PostingList>;
+            MapType _lists;
+
+        public:
+            size_t size() const { return _lists.size(); }
+            bool empty() const { return _lists.empty(); }
+
+            void clear() { _lists.clear(); }
+
+            // lines are added in (docId, lineno) order
+            void add(DocIdType docId, PositionType lineno, StringRef line) {
+                if (line.length() < 3) return;
+                vector<uint32_t> trigrams;
+                trigrams.reserve(line.length() - 2);
+                for (size_t i = 0; i + 3 <= line.length(); i++) trigrams.push_back(_trigram(line.data() + i));
+                sort(trigrams.begin(), trigrams.end());
+                trigrams.erase(unique(trigrams.begin(), trigrams.end()), trigrams.end());
+                for (auto trigram : trigrams) _lists[trigram].append(InvertedIndexValueType(docId, lineno));
+            }
+
+            // adds the lines of rhs, which all come after the lines of this index
+            void append(const TrigramIndex& rhs) {
+                for (const auto& i : rhs._lists) _lists[i.first].append(i.second);
+            }
+
+            void shrink_to_fit() {
+                for (auto& i : _lists) i.second.shrink_to_fit();
+            }
+
+            // the lines that may contain every one of literals. false if no literal is
+            // three bytes long, then the index cannot narrow the search down
+            bool candidates(const vector<string>& literals, PostingVectorType& ret) const {
+                vector<uint32_t> trigrams;
+                for (const auto& literal : literals) {
+                    for (size_t i = 0; i + 3 <= literal.length(); i++) trigrams.push_back(_trigram(literal.data() + i));
+                }
+                if (trigrams.empty()) return false;
+                sort(trigrams.begin(), trigrams.end());
+                trigrams.erase(unique(trigrams.begin(), trigrams.end()), trigrams.end());
+
+                vector<const PostingList*> lists;
+                for (auto trigram : trigrams) {
+                    auto list = _lists.find(trigram);
+                    if (list == _lists.end()) {
+                        ret.clear();
+                        return true;
+                    }
+                    lists.push_back(&list->second);
+                }
+                // the rarest trigram first keeps the intermediate results small
+                sort(lists.begin(), lists.end(), [] (const PostingList* lhs, const PostingList* rhs) {
+                    return lhs->size() < rhs->size();
+                });
+                ret.assign(lists[0]->begin(), lists[0]->end());
+                for (size_t i = 1; i < lists.size() && !ret.empty(); i++) {
+                    ret = Query::intersect(ret, PostingVectorType(lists[i]->begin(), lists[i]->end()));
+                }
+                return true;
+            }
+
+            // strings every match of the ECMAScript regex pattern contains. conservative:
+            // only literal runs outside groups, classes and {m,n} bounds count, a character
+            // that may be repeated zero times ends a run, and a top level alternation gives
+            // nothing. escapes are never literal, nor are the operands of \x, \u and \c
+            static vector<string> literals(const string& pattern) {
+                vector<string> ret;
+                string run;
+                size_t depth = 0;
+                auto endRun = [&ret, &run] () {
+                    if (!run.empty()) ret.push_back(run);
+                    run.clear();
+                };
+                for (size_t i = 0; i < pattern.length(); i++) {
+                    char c = pattern[i];
+                    char next = (i + 1 < pattern.length() ? pattern[i + 1] : '\0');
+                    if (c == '|' && depth == 0) return vector<string>();
+                    if (c == '(') {
+                        depth += 1;
+                        endRun();
+                        continue;
+                    }
+                    // a class is skipped whole at any depth, a ) in it does not close a group
+                    if (c == '[') {
+                        endRun();
+                        for (i += 1; i < pattern.length() && pattern[i] != ']'; i++) {
+                            if (pattern[i] == '\\') i += 1;
+                        }
+                        continue;
+                    }
+                    if (c == ')') {
+                        if (depth > 0) depth -= 1;
+                        endRun();
+                        continue;
+                    }
+                    if (depth > 0) {
+                        if (c == '\\') i += 1;
+                        continue;
+                    }
+                    if (c == '{') {
+                        endRun();
+                        while (i < pattern.length() && pattern[i] != '}') i++;
+                        continue;
+                    }
+
+                    bool literal = true;
+                    if (c == '\\') {
+                        i += 1;
+                        c = next;
+                        next = (i + 1 < pattern.length() ? pattern[i + 1] : '\0');
+                        // \d, \w, \b and the like are classes or assertions, not characters.
+                        // \xhh, \uhhhh and \cX spell one character with the bytes after them
+                        literal = (c != '\0' && !isalnum(static_cast<unsigned char>(c)));
+                        if (!literal) {
+                            i += (c == 'x' ? 2 : c == 'u' ? 4 : c == 'c' ? 1 : 0);
+                            next = (i + 1 < pattern.length() ? pattern[i + 1] : '\0');
+                        }
+                    } else if (string(".^$*+?}").find(c) != string::npos) {
+                        literal = false;
+                    }
+                    if (!literal) {
+                        endRun();
+                        continue;
+                    }
+                    if (next == '*' || next == '?' || next == '{') {
+                        endRun();
+                        continue;
+                    }
+                    run.push_back(c);
+                    if (next == '+') endRun();
+                }
+                endRun();
+                return ret;
+            }
+
+            bool operator == (const TrigramIndex& rhs) const { return _lists == rhs._lists; }
+            bool operator != (const TrigramIndex& rhs) const { return _lists != rhs._lists; }
+
+        private:
+            static uint32_t _trigram(const char* data) {
+                return (static_cast<uint32_t>(static_cast<unsigned char>(data[0])) << 16) |
+                       (static_cast<uint32_t>(static_cast<unsigned char>(data[1])) << 8) |
+                       static_cast<uint32_t>(static_cast<unsigned char>(data[2]));
+            }
+    };
+
+    // the lists in trigram order, written by hand since the map has the type of an
+    // InvertedIndexType whose SerializeFunc writes a posting list directory
+    template <>
+    struct SerializeFunc<TrigramIndex> {
+        void operator () (ByteSink& fout, const TrigramIndex& index) const {
+            vector<const TrigramIndex::MapType::value_type*> lists;
+            lists.reserve(index._lists.size());
+            for (const auto& i : index._lists) lists.push_back(&i);
+            sort(lists.begin(), lists.end(), [] (const TrigramIndex::MapType::value_type* lhs,
+                                                 const TrigramIndex::MapType::value_type* rhs) {
+                return lhs->first < rhs->first;
+            });
+            SerializeFunc<size_t>()(fout, lists.size());
+            for (const auto list : lists) {
+                SerializeFunc<uint32_t>()(fout, list->first);
+                SerializeFunc<PostingList>()(fout, list->second);
+            }
+        }
+    };
+
+    template <>
+    struct DeserializeFunc<TrigramIndex> {
+        void operator () (ByteSource& fin, TrigramIndex& index) const {
+            size_t size = 0;
+            DeserializeFunc<size_t>()(fin, size);
+            index._lists.clear();
+            index._lists.reserve(size);
+            for (size_t i = 0; i < size; i++) {
+                uint32_t trigram = 0;
+                DeserializeFunc<uint32_t>()(fin, trigram);
+                DeserializeFunc<PostingList>()(fin, index._lists[trigram]);
+            }
+        }
+    };
+}
+
+#endif
@@ -4,10 +4,109 @@
 #include <iostream>
 #include <vector>
 #include <unordered_map>
+#include <string>
+#include <cstring>
+#include <cstdint>
+#include <limits>
+#include <exception>
 namespace Darwin {
     using namespace std;
-    using WordIdType = size_t;
-    using DocIdType = size_t;
+
+    // widths of word ids, doc ids and in-document positions (line numbers and term
+    // frequencies). the compact widths halve postings and dictionaries as long as
+    // there are fewer than 2^32 words, documents and lines per document, build with
+    // DARWIN_WIDE_IDS defined for more. an index file records the widths it was written with
+    template <typename WordId, typename DocId, typename Position>
+    struct IdTraits {
+        using WordIdType = WordId;
+        using DocIdType = DocId;
+        using PositionType = Position;
+    };
+    using CompactIdTraits = IdTraits<uint32_t, uint32_t, uint32_t>;
+    using WideIdTraits = IdTraits<size_t, size_t, size_t>;
+#ifdef DARWIN_WIDE_IDS
+    using DefaultIdTraits = WideIdTraits;
+#else
+    using DefaultIdTraits = CompactIdTraits;
+#endif
+
+    using WordIdType = DefaultIdTraits::WordIdType;
+    using DocIdType = DefaultIdTraits::DocIdType;
+    using PositionType = DefaultIdTraits::PositionType;
+
+    class IdOverflow : public exception {
+        private:
+            string _message;
+        public:
+            IdOverflow(const string& message) : _message(message) {}
+            virtual const char* what() const noexcept override {
+                return _message.c_str();
+            }
+    };
+
+    // value as an Id, throws IdOverflow rather than wrap around when it does not fit.
+    // what names the value in the message
+    template <typename Id>
+    inline Id checkedId(size_t value, const char* what) {
+        if (value > numeric_limits<Id>::max()) {
+            throw IdOverflow(string(what) + " " + to_string(value) + " does not fit in " + to_string(sizeof(Id)) +
+                             " bytes, build with DARWIN_WIDE_IDS defined");
+        }
+        return static_cast<Id>(value);
+    }
+
+    // non-owning view of a run of chars, the referenced string must outlive it
+    class StringRef {
+        private:
+            const char* _data;
+            size_t _size;
+        public:
+            StringRef() : _data(""), _size(0) {}
+            StringRef(const char* data, size_t size) : _data(data), _size(size) {}
+            StringRef(const char* data) : _data(data), _size(strlen(data)) {}
+            StringRef(const string& str) : _data(str.data()), _size(str.length()) {}
+
+            const char* data() const { return _data; }
+            size_t size() const { return _size; }
+            size_t length() const { return _size; }
+            bool empty() const { return _size == 0; }
+            const char* begin() const { return _data; }
+            const char* end() const { return _data + _size; }
+            char operator [] (size_t pos) const { return _data[pos]; }
+
+            string str() const { return string(_data, _size); }
+
+            // byte order, a prefix sorts first
+            int compare(const StringRef& rhs) const {
+                int ret = memcmp(_data, rhs._data, _size < rhs._size ? _size : rhs._size);
+                if (ret != 0) return ret;
+                if (_size == rhs._size) return 0;
+                return _size < rhs._size ? -1 : 1;
+            }
+
+            friend bool operator == (const StringRef& lhs, const StringRef& rhs) {
+                if (lhs._size != rhs._size) return false;
+                return lhs._size == 0 || memcmp(lhs._data, rhs._data, lhs._size) == 0;
+            }
+            friend bool operator != (const StringRef& lhs, const StringRef& rhs) {
+                return !(lhs == rhs);
+            }
+            friend ostream& operator << (ostream& out, const StringRef& str) {
+                return out.write(str._data, str._size);
+            }
+    };
+
+    // 64 bit FNV-1a
+    struct StringRefHash {
+        size_t operator () (const StringRef& str) const {
+            size_t hash = 14695981039346656037ULL;
+            for (auto c : str) {
+                hash ^= static_cast<unsigned char>(c);
+                hash *= 1099511628211ULL;
+            }
+            return hash;
+        }
+    };
 
     struct Result {
         DocIdType docId;
@@ -40,6 +139,15 @@ namespace Darwin {
     }
 
     using SearchResultType = vector<Result>;
+
+    struct RankedResult {
+        double score;
+        Result result;
+
+        RankedResult(double score, Result&& result) : score(score), result(move(result)) {}
+    };
+
+    using RankedResultType = vector<RankedResult>;
 }
 
 #endif
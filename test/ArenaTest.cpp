@@ -0,0 +1,75 @@
+#include "gtest/gtest.h"
+#include "darwin.hpp"
+#include "Arena.hpp"
+#include "Tokenizer.hpp"
+#include <string>
+#include <vector>
+#include <map>
+
+using namespace Darwin;
+using namespace std;
+
+TEST(ArenaTest, Allocate) {
+    Arena arena;
+    char* c = static_cast<char*>(arena.allocate(1, 1));
+    uint64_t* u = static_cast<uint64_t*>(arena.allocate(sizeof(uint64_t), alignof(uint64_t)));
+    ASSERT_EQ(reinterpret_cast<uintptr_t>(u) % alignof(uint64_t), 0);
+    ASSERT_GT(reinterpret_cast<char*>(u), c);
+    ASSERT_EQ(arena.bytes(), 1 + sizeof(uint64_t));
+
+    // a large request gets a block of its own, small ones go on in the current block
+    size_t capacity = arena.capacity();
+    char* large = static_cast<char*>(arena.allocate(1 << 20));
+    ASSERT_EQ(arena.capacity(), capacity + (1 << 20));
+    char* next = static_cast<char*>(arena.allocate(1, 1));
+    ASSERT_TRUE(next < large || next >= large + (1 << 20));
+    ASSERT_EQ(arena.capacity(), capacity + (1 << 20));
+
+    StringRef word = arena.copy("harry potter");
+    ASSERT_EQ(word, "harry potter");
+    ASSERT_EQ(arena.copy(""), "");
+}
+
+TEST(ArenaTest, Containers) {
+    Arena arena;
+    using MapType = map<size_t, string, less<size_t>, ArenaAllocator<pair<const size_t, string>>>;
+    MapType numbers{MapType::allocator_type(&arena)};
+    for (size_t i = 0; i < 10000; i++) numbers[i] = to_string(i);
+    ASSERT_EQ(numbers.size(), 10000);
+    ASSERT_EQ(numbers[1234], "1234");
+    ASSERT_GT(arena.bytes(), 10000 * sizeof(MapType::value_type));
+
+    // the arena moves along with the elements
+    MapType moved(move(numbers));
+    ASSERT_EQ(moved.get_allocator(), ArenaAllocator<int>(&arena));
+    ASSERT_EQ(moved[9999], "9999");
+}
+
+TEST(ArenaTest, WordDictionary) {
+    WordDictionary words = {{"harry", 1}, {"potter", 2}};
+    const char* harry = words.find("harry")->first.data();
+    ASSERT_GT(words.arenaBytes(), 0);
+
+    // only the words go to the arena, rehashing the map does not add to it
+    for (size_t i = 0; i < 1000; i++) words.insert(to_string(i), i + 3);
+    size_t arenaBytes = words.arenaBytes();
+    words.reserve(1 << 16);
+    ASSERT_EQ(words.arenaBytes(), arenaBytes);
+    ASSERT_EQ(words.find("harry")->first.data(), harry);
+
+    // moving keeps the words where they are, copying does not share them
+    WordDictionary moved(move(words));
+    ASSERT_EQ(moved.find("harry")->first.data(), harry);
+    ASSERT_EQ(moved.find("potter")->second, 2);
+    WordDictionary copied = moved;
+    ASSERT_NE(copied.find("harry")->first.data(), harry);
+    ASSERT_EQ(copied, moved);
+
+    // a moved from dictionary can be used again
+    ASSERT_EQ(words.size(), 0);
+    words.insert("dream", 1);
+    ASSERT_EQ(words.find("dream")->second, 1);
+    moved.clear();
+    ASSERT_EQ(moved.size(), 0);
+    ASSERT_TRUE(moved.find("harry") == moved.end());
+}
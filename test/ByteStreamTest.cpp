@@ -0,0 +1,74 @@
+#include "gtest/gtest.h"
+#include "darwin.hpp"
+#include "ByteStream.hpp"
+#include "Serializer.hpp"
+#include <string>
+#include <vector>
+#include <unordered_map>
+
+using namespace Darwin;
+using namespace std;
+
+TEST(ByteStreamTest, VectorSinkAndMemorySource) {
+    Serializer serializer;
+    unordered_map<string, vector<int>> data = {{"harry", {1, 2, 3}}, {"potter", {}}, {"dream", {42}}};
+
+    // a buffer smaller than most writes exercises the flush paths
+    VectorSink sink(4);
+    serializer.serialize(sink, data);
+    serializer.serialize(sink, string("tail"));
+
+    MemorySource source(sink.data());
+    unordered_map<string, vector<int>> backup;
+    string tail;
+    serializer.deserialize(source, backup);
+    serializer.deserialize(source, tail);
+    ASSERT_TRUE(source.good());
+    ASSERT_EQ(data, backup);
+    ASSERT_EQ(tail, "tail");
+}
+
+TEST(ByteStreamTest, FileSinkAndSource) {
+    const string fname = "dump/byte_stream";
+    string big(100000, 'x');
+    for (size_t i = 0; i < big.length(); i++) big[i] = 'a' + i % 26;
+    vector<string> data = {"shell", big, "", "code"};
+
+    {
+        FileSink sink(fname, 1024);
+        ASSERT_TRUE(sink.is_open());
+        Serializer().serialize(sink, data);
+    }
+
+    for (size_t bufferSize : {size_t(7), size_t(1024), size_t(1 << 20)}) {
+        FileSource source(fname, bufferSize);
+        vector<string> backup;
+        Serializer().deserialize(source, backup);
+        ASSERT_TRUE(source.good());
+        ASSERT_EQ(data, backup);
+    }
+
+    MappedSource mapped(fname);
+    vector<string> backup;
+    Serializer().deserialize(mapped, backup);
+    ASSERT_TRUE(mapped.good());
+    ASSERT_EQ(data, backup);
+}
+
+TEST(ByteStreamTest, ReadPastEnd) {
+    const char data[] = {1, 2, 3};
+    MemorySource source(data, sizeof(data));
+    char buffer[4] = {9, 9, 9, 9};
+    ASSERT_TRUE(source.read(buffer, 2));
+    ASSERT_FALSE(source.read(buffer, 2));
+    ASSERT_FALSE(source.good());
+    ASSERT_EQ(buffer[0], 0);
+    ASSERT_EQ(buffer[1], 0);
+
+    FileSource missing("dump/no_such_stream");
+    ASSERT_FALSE(missing.is_open());
+    int i = 7;
+    Serializer().deserialize(missing, i);
+    ASSERT_FALSE(missing.good());
+    ASSERT_EQ(i, 0);
+}
@@ -0,0 +1,111 @@
+#include "gtest/gtest.h"
+#include "darwin.hpp"
+#include "ConcurrentWordMap.hpp"
+#include <string>
+#include <vector>
+#include <thread>
+#include <unordered_set>
+
+using namespace Darwin;
+using namespace std;
+
+class ConcurrentTokenizerValidator;
+using ConcurrentTokenizer4Test = TokenizerT<ConcurrentTokenizerValidator, ConcurrentWordMap>;
+class ConcurrentTokenizerValidator {
+    public:
+        void validateWordNum(const ConcurrentTokenizer4Test& tokenizer, size_t wordNum) {
+            ASSERT_EQ(tokenizer._wordMap.size(), wordNum);
+        }
+};
+
+TEST(ConcurrentWordMapTest, InsertAndFind) {
+    ConcurrentWordMap wordMap;
+    vector<string> words = {"i", "have", "a", "dream"};
+    for (size_t i = 0; i < words.size(); i++) {
+        ASSERT_EQ(wordMap.insert(words[i]), i + 1);
+    }
+    for (size_t i = 0; i < words.size(); i++) {
+        ASSERT_EQ(wordMap.insert(words[i]), i + 1);
+        ASSERT_EQ(wordMap.find(words[i]), i + 1);
+    }
+    ASSERT_EQ(wordMap.find("nightmare"), 0);
+    ASSERT_EQ(wordMap.size(), words.size());
+
+    // enough words to grow every shard several times
+    for (size_t i = 0; i < 20000; i++) {
+        wordMap.insert("w" + to_string(i));
+    }
+    ASSERT_EQ(wordMap.size(), words.size() + 20000);
+    ASSERT_EQ(wordMap.find("dream"), 4);
+    ASSERT_EQ(wordMap.find("w0"), 5);
+}
+
+TEST(ConcurrentWordMapTest, ConcurrentTokenize) {
+    const size_t threadNum = 8;
+    const size_t wordNum = 5000;
+    ConcurrentTokenizer4Test tokenizer;
+
+    // every thread sees every word, in a different order
+    vector<vector<WordIdType>> wordIds(threadNum);
+    vector<thread> workers;
+    for (size_t t = 0; t < threadNum; t++) {
+        workers.push_back(thread([&tokenizer, &wordIds, t, wordNum] () {
+            for (size_t i = 0; i < wordNum; i++) {
+                auto word = "w" + to_string((i * 7 + t * 613) % wordNum);
+                wordIds[t].push_back(tokenizer.tokenize(word + " " + word)[0]);
+            }
+        }));
+    }
+    for (auto& worker : workers) worker.join();
+
+    ConcurrentTokenizerValidator validator;
+    validator.validateWordNum(tokenizer, wordNum);
+
+    unordered_set<WordIdType> ids;
+    for (size_t i = 0; i < wordNum; i++) {
+        auto wordId = tokenizer.getWordId("w" + to_string(i));
+        ASSERT_GE(wordId, 1);
+        ASSERT_LE(wordId, wordNum);
+        ids.insert(wordId);
+    }
+    ASSERT_EQ(ids.size(), wordNum);
+
+    for (size_t t = 0; t < threadNum; t++) {
+        for (size_t i = 0; i < wordNum; i++) {
+            auto word = "w" + to_string((i * 7 + t * 613) % wordNum);
+            ASSERT_EQ(wordIds[t][i], tokenizer.getWordId(word));
+        }
+    }
+}
+
+TEST(ConcurrentWordMapTest, Serialization) {
+    ConcurrentTokenizer4Test tokenizer;
+    tokenizer.tokenize("I have a dream, a very very very big dream. Do you have a dream?", " ,.?");
+
+    Serializer serializer;
+    serializer.serialize("dump/concurrent_tokenizer", tokenizer);
+    ConcurrentTokenizer4Test backupTokenizer;
+    serializer.deserialize("dump/concurrent_tokenizer", backupTokenizer);
+    ASSERT_EQ(tokenizer, backupTokenizer);
+
+    ConcurrentTokenizer4Test copyTokenizer(tokenizer);
+    ASSERT_EQ(tokenizer, copyTokenizer);
+    ASSERT_EQ(copyTokenizer.getWordId("dream"), 4);
+    ASSERT_EQ(copyTokenizer.tokenize("nightmare")[0], 9);
+}
+
+TEST(ConcurrentWordMapTest, WordIdOverflow) {
+    // a dictionary whose largest id is the last one the id width holds
+    VectorSink sink;
+    SerializeFunc<ConcurrentWordMap::size_type>()(sink, 1);
+    SerializeFunc<string>()(sink, "last");
+    SerializeFunc<WordIdType>()(sink, numeric_limits<WordIdType>::max());
+    MemorySource source(sink.data());
+    ConcurrentWordMap wordMap;
+    DeserializeFunc<ConcurrentWordMap>()(source, wordMap);
+
+    ASSERT_EQ(wordMap.insert("last"), numeric_limits<WordIdType>::max());
+    ASSERT_THROW(wordMap.insert("next"), IdOverflow);
+    ASSERT_EQ(wordMap.find("next"), 0);
+    ASSERT_EQ(wordMap.size(), numeric_limits<WordIdType>::max());
+}
@@ -0,0 +1,41 @@
+#ifndef __CORPUS_HPP__
+#define __CORPUS_HPP__
+
+#include <string>
+#include <fstream>
+#include "darwin.hpp"
+
+using namespace Darwin;
+using namespace std;
+
+// writes docNum documents dump/<prefix>_doc<d> of lineNum lines each, line(d, lineno)
+// being the content of a line, and lists them in dump/<prefix>_documents, which is returned
+template <typename Line>
+string writeCorpus(const string& prefix, size_t docNum, size_t lineNum, Line line) {
+    string documentsName = "dump/" + prefix + "_documents";
+    ofstream documents(documentsName);
+    for (size_t d = 0; d < docNum; d++) {
+        string docName = prefix + "_doc" + to_string(d);
+        documents << d << " " << docName << "\n";
+        ofstream doc("dump/" + docName);
+        for (size_t lineno = 0; lineno < lineNum; lineno++) doc << line(d, lineno) << "\n";
+    }
+    return documentsName;
+}
+
+// every line of the corpus written by writeCorpus that match accepts, the way a full scan finds them
+template <typename Match>
+SearchResultType scanCorpus(const string& prefix, size_t docNum, Match match) {
+    SearchResultType result;
+    for (size_t d = 0; d < docNum; d++) {
+        string docName = prefix + "_doc" + to_string(d);
+        ifstream doc("dump/" + docName);
+        string line;
+        for (size_t lineno = 0; getline(doc, line); lineno++) {
+            if (match(line)) result.push_back(Result(d, docName, lineno, line));
+        }
+    }
+    return result;
+}
+
+#endif
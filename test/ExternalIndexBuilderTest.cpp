@@ -0,0 +1,84 @@
+#include "gtest/gtest.h"
+#include "darwin.hpp"
+#include "IndexBuilder.hpp"
+#include "ExternalIndexBuilder.hpp"
+#include "LazyIndex.hpp"
+#include "Corpus.hpp"
+#include <string>
+#include <vector>
+#include <fstream>
+#include <sstream>
+
+using namespace Darwin;
+using namespace std;
+
+namespace {
+    string readFile(const string& fname) {
+        ifstream fin(fname, ios_base::in | ios_base::binary);
+        stringstream content;
+        content << fin.rdbuf();
+        return content.str();
+    }
+
+    void writeCorpus(size_t docNum) {
+        ::writeCorpus("external", docNum, 20, [] (size_t d, size_t lineno) {
+            return "line " + to_string(lineno) + " of doc " + to_string(d) + " word" + to_string((d * lineno) % 17) + " common";
+        });
+    }
+}
+
+TEST(ExternalIndexBuilderTest, SameDumpAsIndexBuilder) {
+    writeCorpus(30);
+    IndexBuilder indexBuilder((Tokenizer()));
+    indexBuilder.build("dump/external_documents");
+    Serializer serializer;
+    serializer.serialize("dump/external_expected", indexBuilder);
+    string expected = readFile("dump/external_expected");
+
+    // a budget that holds a few documents and one that holds them all
+    for (size_t budget : {size_t(1000), size_t(64 << 20)}) {
+        ExternalIndexBuilder externalBuilder(Tokenizer(), budget);
+        externalBuilder.build("dump/external_documents", "dump/external_index");
+        if (budget == 1000) {
+            ASSERT_GT(externalBuilder.runNum(), 5);
+        } else {
+            ASSERT_EQ(externalBuilder.runNum(), 1);
+        }
+        ASSERT_EQ(readFile("dump/external_index"), expected);
+        ASSERT_FALSE(ifstream("dump/external_index.run0").good());
+    }
+
+    LazyIndex lazyIndex("dump/external_index");
+    ASSERT_EQ(lazyIndex.search("common"), indexBuilder.search("common"));
+    ASSERT_EQ(lazyIndex.search(Query::parse("doc AND word3")), indexBuilder.search(Query::parse("doc AND word3")));
+}
+
+TEST(ExternalIndexBuilderTest, MergePasses) {
+    writeCorpus(30);
+    IndexBuilder indexBuilder((Tokenizer()));
+    indexBuilder.build("dump/external_documents");
+    Serializer serializer;
+    serializer.serialize("dump/external_expected", indexBuilder);
+
+    // a run per document merged three at a time takes several passes
+    ExternalIndexBuilder externalBuilder(Tokenizer(), 1, 3);
+    ASSERT_EQ(externalBuilder.fanIn(), 3);
+    externalBuilder.build("dump/external_documents", "dump/external_index");
+    ASSERT_EQ(externalBuilder.runNum(), 30);
+    ASSERT_EQ(readFile("dump/external_index"), readFile("dump/external_expected"));
+    ASSERT_FALSE(ifstream("dump/external_index.pass0.0").good());
+    ASSERT_FALSE(ifstream("dump/external_index.lists").good());
+}
+
+TEST(ExternalIndexBuilderTest, Empty) {
+    ofstream("dump/external_empty_documents").close();
+    ExternalIndexBuilder externalBuilder((Tokenizer()));
+    externalBuilder.build("dump/external_empty_documents", "dump/external_empty_index");
+    ASSERT_EQ(externalBuilder.runNum(), 0);
+
+    IndexBuilder indexBuilder((Tokenizer()));
+    Serializer serializer;
+    serializer.deserialize("dump/external_empty_index", indexBuilder);
+    ASSERT_TRUE(indexBuilder.documents().empty());
+    ASSERT_TRUE(indexBuilder.search("common").empty());
+}
@@ -0,0 +1,110 @@
+#include "gtest/gtest.h"
+#include "darwin.hpp"
+#include "FileCache.hpp"
+#include <string>
+#include <vector>
+#include <fstream>
+#include <cstdio>
+#include <thread>
+
+using namespace Darwin;
+using namespace std;
+
+TEST(FileCacheTest, ReadLine) {
+    const string fname = "dump/file_cache";
+    string longLine(10000, 'x');
+    ofstream fout(fname, ios_base::out | ios_base::binary);
+    fout << "shell code\n" << longLine << "\n" << "harry potter";
+    fout.close();
+
+    FileCache fileCache;
+    ASSERT_EQ(fileCache.readLine(fname, 0), "shell code");
+    ASSERT_EQ(fileCache.readLine(fname, 6), "code");
+    ASSERT_EQ(fileCache.readLine(fname, 11), longLine);
+    ASSERT_EQ(fileCache.readLine(fname, 11 + longLine.length() + 1), "harry potter");
+    ASSERT_EQ(fileCache.readLine(fname, 1 << 20), "");
+    ASSERT_EQ(fileCache.readLine("dump/no_such_file", 0), "");
+    ASSERT_EQ(fileCache.size(), 1);
+}
+
+TEST(FileCacheTest, ShortLineAfterLongLine) {
+    // the buffer of the thread grows to the long line, the short lines after it still
+    // come back whole and alone, including ones longer than a read chunk
+    const string fname = "dump/file_cache_long";
+    string longLine(100000, 'y');
+    string chunkLine(5000, 'z');
+    ofstream fout(fname, ios_base::out | ios_base::binary);
+    fout << longLine << "\nshort\n" << chunkLine << "\n" << longLine << "\nlast";
+    fout.close();
+
+    FileCache fileCache;
+    size_t shortOffset = longLine.length() + 1;
+    size_t chunkOffset = shortOffset + 6;
+    ASSERT_EQ(fileCache.readLine(fname, 0), longLine);
+    ASSERT_EQ(fileCache.readLine(fname, shortOffset), "short");
+    ASSERT_EQ(fileCache.readLine(fname, chunkOffset), chunkLine);
+    ASSERT_EQ(fileCache.readLine(fname, chunkOffset + chunkLine.length() + 1), longLine);
+    ASSERT_EQ(fileCache.readLine(fname, chunkOffset + chunkLine.length() + longLine.length() + 2), "last");
+}
+
+TEST(FileCacheTest, Eviction) {
+    vector<string> fnames = {"dump/file_cache_0", "dump/file_cache_1", "dump/file_cache_2"};
+    for (size_t i = 0; i < fnames.size(); i++) {
+        ofstream fout(fnames[i], ios_base::out | ios_base::binary);
+        fout << "line " << i << "\n";
+    }
+
+    FileCache fileCache(2);
+    for (size_t round = 0; round < 3; round++) {
+        for (size_t i = 0; i < fnames.size(); i++) {
+            ASSERT_EQ(fileCache.readLine(fnames[i], 0), "line " + to_string(i));
+            ASSERT_LE(fileCache.size(), 2);
+        }
+    }
+
+    FileCache copy(fileCache);
+    ASSERT_EQ(copy.size(), 0);
+    ASSERT_EQ(copy.readLine(fnames[0], 5), "0");
+}
+
+TEST(FileCacheTest, Invalidate) {
+    const string fname = "dump/file_cache_replaced";
+    ofstream("dump/file_cache_replaced", ios_base::out | ios_base::binary) << "alpha beta\n";
+    FileCache fileCache;
+    ASSERT_EQ(fileCache.readLine(fname, 0), "alpha beta");
+
+    // replaced by rename, the cached descriptor still reads the old file
+    ofstream("dump/file_cache_replacement", ios_base::out | ios_base::binary) << "gamma\n";
+    ASSERT_EQ(rename("dump/file_cache_replacement", fname.c_str()), 0);
+    ASSERT_EQ(fileCache.readLine(fname, 0), "alpha beta");
+
+    fileCache.invalidate(fname);
+    ASSERT_EQ(fileCache.size(), 0);
+    ASSERT_EQ(fileCache.readLine(fname, 0), "gamma");
+    fileCache.invalidate("dump/no_such_file");
+    ASSERT_EQ(fileCache.size(), 1);
+}
+
+TEST(FileCacheTest, ConcurrentReadLine) {
+    const size_t fileNum = 8;
+    for (size_t i = 0; i < fileNum; i++) {
+        ofstream fout("dump/file_cache_" + to_string(i), ios_base::out | ios_base::binary);
+        fout << "line " << i << "\n";
+    }
+
+    FileCache fileCache(3);
+    vector<thread> workers;
+    vector<int> ok(8, 1);
+    for (size_t t = 0; t < ok.size(); t++) {
+        workers.push_back(thread([&fileCache, &ok, t, fileNum] () {
+            for (size_t i = 0; i < 2000; i++) {
+                auto f = (i * 5 + t) % fileNum;
+                if (fileCache.readLine("dump/file_cache_" + to_string(f), 0) != "line " + to_string(f)) ok[t] = 0;
+            }
+        }));
+    }
+    for (auto& worker : workers) worker.join();
+    for (size_t t = 0; t < ok.size(); t++) {
+        ASSERT_TRUE(ok[t]);
+    }
+}
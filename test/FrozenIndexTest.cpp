@@ -0,0 +1,64 @@
+#include "gtest/gtest.h"
+#include "darwin.hpp"
+#include "IndexBuilder.hpp"
+#include "FrozenIndex.hpp"
+#include <string>
+#include <vector>
+
+using namespace Darwin;
+using namespace std;
+
+TEST(FrozenIndexTest, Documents) {
+    IndexBuilder indexBuilder((Tokenizer()));
+    indexBuilder.build("data/documents");
+    FrozenIndex index = indexBuilder.freeze();
+    ASSERT_EQ(index.documentNum(), 4);
+    ASSERT_EQ(index.termNum(), 10);
+    ASSERT_EQ(index.dataDirectory(), "data/");
+    vector<string> expDocList = {"doc1", "doc2", "doc3", "doc4"};
+    for (size_t i = 0; i < expDocList.size(); i++) {
+        ASSERT_EQ(index.documentName(i).str(), expDocList[i]);
+    }
+    ASSERT_GT(index.bytes(), 0);
+}
+
+TEST(FrozenIndexTest, Search) {
+    IndexBuilder indexBuilder((Tokenizer()));
+    indexBuilder.build("data/documents");
+    FrozenIndex index = indexBuilder.freeze();
+
+    vector<string> keys = {"shell", "code", "harry", "potter", "i", "have", "a", "dream", "do", "you", "ruochen", "", "zzz"};
+    for (const auto& key : keys) {
+        ASSERT_EQ(index.search(key), indexBuilder.search(key));
+    }
+
+    vector<string> queries = {"harry AND potter", "have AND NOT you", "shell OR dream"};
+    for (const auto& query : queries) {
+        ASSERT_EQ(index.search(Query::parse(query)), indexBuilder.search(Query::parse(query)));
+    }
+
+    auto postings = index.postings("dream");
+    PostingList expPostings = {{2, 0}, {3, 0}};
+    ASSERT_EQ(postings.size(), expPostings.size());
+    ASSERT_TRUE(equal(postings.begin(), postings.end(), expPostings.begin()));
+
+    auto cursor = index.searchCursor("harry", 1);
+    ASSERT_EQ(cursor.next(), Result(1, "doc2", 0, "harry potter"));
+    ASSERT_TRUE(cursor.done());
+}
+
+TEST(FrozenIndexTest, RankedSearch) {
+    IndexBuilder indexBuilder((Tokenizer()));
+    indexBuilder.build("data/documents");
+    FrozenIndex index = indexBuilder.freeze();
+
+    for (const string query : {"have dream you", "harry", "a shell ruochen", "ruochen"}) {
+        auto results = index.searchTopK(query, 5);
+        auto expResults = indexBuilder.searchTopK(query, 5);
+        ASSERT_EQ(results.size(), expResults.size());
+        for (size_t i = 0; i < results.size(); i++) {
+            ASSERT_EQ(results[i].result, expResults[i].result);
+            ASSERT_DOUBLE_EQ(results[i].score, expResults[i].score);
+        }
+    }
+}
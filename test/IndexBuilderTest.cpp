@@ -27,9 +27,7 @@ class IndexBuilderValidator {
                ASSERT_NE(info, index.end());
                ASSERT_EQ(typeid(info->second), typeid(i.second));
                ASSERT_EQ(info->second.size(), i.second.size());
-               for (const auto& v : info->second) {
-                   ASSERT_NE(i.second.find(v), i.second.end());
-               }
+               ASSERT_EQ(info->second, i.second);
            }
         }
         void validateLineContent(const IndexBuilder4Test& indexBuilder, const pair<DocIdType, size_t>& pos, const string& lineContent) {
@@ -69,18 +67,18 @@ TEST(IndexBuilderTest, BuildInvertedIndex) {
 
     indexBuilder.build("data/documents");
 
-    // harry : docId = 0, offset = 11, lineno = 1 | docId = 1, offset = 0, lineno = 0
+    // harry : docId = 0, lineno = 1 | docId = 1, lineno = 0
     InvertedIndexType index = {
-        {indexBuilder.getWordId("shell"), {{0, 0, 0}}} ,
-        {indexBuilder.getWordId("code"), {{0, 0, 0}}} ,
-        {indexBuilder.getWordId("harry"), {{0, 11, 1}, {1, 0, 0}}} ,
-        {indexBuilder.getWordId("potter"), {{0, 11, 1}, {1, 0, 0}}} ,
-        {indexBuilder.getWordId("i"), {{2, 0, 0}}} ,
-        {indexBuilder.getWordId("have"), {{2, 0, 0}, {3, 0, 0}}} ,
-        {indexBuilder.getWordId("a"), {{2, 0, 0}, {3, 0, 0}}} ,
-        {indexBuilder.getWordId("dream"), {{2, 0, 0}, {3, 0, 0}}} ,
-        {indexBuilder.getWordId("do"), {{3, 0, 0}}} ,
-        {indexBuilder.getWordId("you"), {{3, 0, 0}}} 
+        {indexBuilder.getWordId("shell"), {{0, 0}}} ,
+        {indexBuilder.getWordId("code"), {{0, 0}}} ,
+        {indexBuilder.getWordId("harry"), {{0, 1}, {1, 0}}} ,
+        {indexBuilder.getWordId("potter"), {{0, 1}, {1, 0}}} ,
+        {indexBuilder.getWordId("i"), {{2, 0}}} ,
+        {indexBuilder.getWordId("have"), {{2, 0}, {3, 0}}} ,
+        {indexBuilder.getWordId("a"), {{2, 0}, {3, 0}}} ,
+        {indexBuilder.getWordId("dream"), {{2, 0}, {3, 0}}} ,
+        {indexBuilder.getWordId("do"), {{3, 0}}} ,
+        {indexBuilder.getWordId("you"), {{3, 0}}} 
     };
 
     validator.validateInvertedIndex(indexBuilder, index);
@@ -108,8 +106,8 @@ TEST(IndexBuilderTest, Search) {
     vector<string> keys = {"shell", "harry", "dream", "ruochen"};
     vector<SearchResultType> expResults = {
         {{0, "doc1", 0, "shell code"}},
-        {{1, "doc2", 0, "harry potter"}, {0, "doc1", 1, "harry potter"}},
-        {{3, "doc4", 0, "do you have a dream"}, {2, "doc3", 0, "i have a dream"}},
+        {{0, "doc1", 1, "harry potter"}, {1, "doc2", 0, "harry potter"}},
+        {{2, "doc3", 0, "i have a dream"}, {3, "doc4", 0, "do you have a dream"}},
         {{}}
     };
 
@@ -129,3 +127,64 @@ TEST(IndexBuilderTest, Serialization) {
     serializer.deserialize(fname, backupIndexBuilder);
     ASSERT_EQ(indexBuilder, backupIndexBuilder);
 }
+
+TEST(IndexBuilderTest, ParallelBuild) {
+    IndexBuilder4Test indexBuilder((Tokenizer()));
+    indexBuilder.build("data/documents");
+
+    vector<size_t> threadNums = {2, 3, 4, 8};
+    for (const auto& threadNum : threadNums) {
+        IndexBuilder4Test parallelIndexBuilder((Tokenizer()));
+        parallelIndexBuilder.build("data/documents", threadNum);
+        ASSERT_EQ(indexBuilder, parallelIndexBuilder);
+    }
+}
+
+TEST(IndexBuilderTest, BooleanSearch) {
+    IndexBuilder4Test indexBuilder((Tokenizer()));
+    indexBuilder.build("data/documents");
+
+    vector<string> queries = {"harry AND potter", "have AND NOT you", "shell OR dream", "harry AND dream"};
+    vector<SearchResultType> expResults = {
+        {{0, "doc1", 1, "harry potter"}, {1, "doc2", 0, "harry potter"}},
+        {{2, "doc3", 0, "i have a dream"}},
+        {{0, "doc1", 0, "shell code"}, {2, "doc3", 0, "i have a dream"}, {3, "doc4", 0, "do you have a dream"}},
+        {}
+    };
+
+    for (size_t i = 0; i < queries.size(); i++) {
+        ASSERT_EQ(indexBuilder.search(Query::parse(queries[i])), expResults[i]);
+    }
+}
+
+TEST(IndexBuilderTest, RankedSearch) {
+    IndexBuilder4Test indexBuilder((Tokenizer()));
+    indexBuilder.build("data/documents");
+    LineLengthListType expLineLengths = {{2, 2}, {2}, {4}, {5}};
+    ASSERT_EQ(indexBuilder.lineLengths(), expLineLengths);
+
+    // the line with the rare word comes first, equal scores keep line order
+    auto results = indexBuilder.searchTopK("have dream you", 5);
+    ASSERT_EQ(results.size(), 2);
+    ASSERT_EQ(results[0].result, Result(3, "doc4", 0, "do you have a dream"));
+    ASSERT_EQ(results[1].result, Result(2, "doc3", 0, "i have a dream"));
+    ASSERT_GT(results[0].score, results[1].score);
+
+    results = indexBuilder.searchTopK("harry", 1);
+    ASSERT_EQ(results.size(), 1);
+    ASSERT_EQ(results[0].result, Result(0, "doc1", 1, "harry potter"));
+    ASSERT_TRUE(indexBuilder.searchTopK("ruochen", 5).empty());
+}
+
+TEST(IndexBuilderTest, CheckedId) {
+    ASSERT_EQ(checkedId<uint8_t>(255, "doc id"), 255);
+    ASSERT_THROW(checkedId<uint8_t>(256, "doc id"), IdOverflow);
+    ASSERT_EQ(checkedId<uint32_t>(numeric_limits<uint32_t>::max(), "line number"), numeric_limits<uint32_t>::max());
+    ASSERT_THROW(checkedId<uint32_t>(size_t(1) << 32, "line number"), IdOverflow);
+    try {
+        checkedId<uint16_t>(70000, "line number");
+        FAIL();
+    } catch (const IdOverflow& e) {
+        ASSERT_NE(string(e.what()).find("DARWIN_WIDE_IDS"), string::npos);
+    }
+}
@@ -0,0 +1,68 @@
+#include "gtest/gtest.h"
+#include "darwin.hpp"
+#include "IndexBuilder.hpp"
+#include "Serializer.hpp"
+#include "LazyIndex.hpp"
+#include <string>
+#include <vector>
+#include <fstream>
+
+using namespace Darwin;
+using namespace std;
+
+TEST(LazyIndexTest, Search) {
+    const string fname = "dump/lazy_index";
+    IndexBuilder indexBuilder((Tokenizer()));
+    indexBuilder.build("data/documents");
+    Serializer().serialize(fname, indexBuilder);
+
+    LazyIndex index(fname);
+    ASSERT_EQ(index.documents(), indexBuilder.documents());
+    ASSERT_EQ(index.tokenizer(), indexBuilder.tokenizer());
+    ASSERT_EQ(index.termNum(), 10);
+    ASSERT_EQ(index.cache().size(), 0);
+
+    vector<string> keys = {"shell", "code", "harry", "potter", "i", "have", "a", "dream", "do", "you", "ruochen", ""};
+    for (const auto& key : keys) {
+        ASSERT_EQ(index.search(key), indexBuilder.search(key));
+    }
+    ASSERT_EQ(index.cache().size(), 10);
+
+    vector<string> queries = {"harry AND potter", "have AND NOT you", "shell OR dream"};
+    for (const auto& query : queries) {
+        ASSERT_EQ(index.search(Query::parse(query)), indexBuilder.search(Query::parse(query)));
+    }
+}
+
+TEST(LazyIndexTest, BoundedCache) {
+    const string fname = "dump/lazy_index";
+    IndexBuilder indexBuilder((Tokenizer()));
+    indexBuilder.build("data/documents");
+    Serializer().serialize(fname, indexBuilder);
+
+    // a list encodes to a few bytes here, the cache keeps about two of them
+    size_t bytes = indexBuilder.index().find(indexBuilder.getWordId("harry"))->second.bytes();
+    LazyIndex index(fname, 2 * bytes);
+    auto harry = index.postings("harry");
+    index.postings("potter");
+    index.postings("dream");
+    index.postings("have");
+    ASSERT_LE(index.cache().bytes(), 2 * bytes);
+    ASSERT_GE(index.cache().size(), 1);
+
+    // an evicted list stays valid while it is held
+    PostingList expPostings = {{0, 1}, {1, 0}};
+    ASSERT_EQ(harry.size(), expPostings.size());
+    ASSERT_TRUE(equal(harry.begin(), harry.end(), expPostings.begin()));
+    ASSERT_TRUE(index.postings("ruochen").empty());
+}
+
+TEST(LazyIndexTest, InvalidFile) {
+    const string fname = "dump/not_lazy_index";
+    ofstream fout(fname, ios_base::out | ios_base::binary);
+    fout << "short";
+    fout.close();
+
+    ASSERT_THROW(LazyIndex index(fname), LazyIndexError);
+    ASSERT_THROW(LazyIndex index("dump/no_such_index"), LazyIndexError);
+}
@@ -0,0 +1,43 @@
+#include "gtest/gtest.h"
+#include "darwin.hpp"
+#include "LevenshteinAutomaton.hpp"
+#include <string>
+
+using namespace Darwin;
+using namespace std;
+
+namespace {
+    LevenshteinAutomaton::State feed(const LevenshteinAutomaton& automaton, const string& str) {
+        auto state = automaton.start();
+        for (auto c : str) state = automaton.step(state, c);
+        return state;
+    }
+}
+
+TEST(LevenshteinAutomatonTest, Distance) {
+    LevenshteinAutomaton automaton("kitten", 2);
+    ASSERT_EQ(automaton.maxDistance(), 2);
+    ASSERT_EQ(automaton.distance(feed(automaton, "kitten")), 0);
+    ASSERT_EQ(automaton.distance(feed(automaton, "sitten")), 1);
+    ASSERT_EQ(automaton.distance(feed(automaton, "kiten")), 1);
+    ASSERT_EQ(automaton.distance(feed(automaton, "kittens")), 1);
+    ASSERT_EQ(automaton.distance(feed(automaton, "sittin")), 2);
+    // more than maxDistance is reported as maxDistance + 1
+    ASSERT_EQ(automaton.distance(feed(automaton, "sitting")), 3);
+    ASSERT_TRUE(automaton.isMatch(feed(automaton, "sittin")));
+    ASSERT_FALSE(automaton.isMatch(feed(automaton, "sitting")));
+}
+
+TEST(LevenshteinAutomatonTest, CanMatch) {
+    LevenshteinAutomaton automaton("dream", 1);
+    ASSERT_TRUE(automaton.canMatch(automaton.start()));
+    ASSERT_TRUE(automaton.canMatch(feed(automaton, "dr")));
+    ASSERT_TRUE(automaton.canMatch(feed(automaton, "xr")));
+    ASSERT_FALSE(automaton.isMatch(feed(automaton, "dr")));
+    ASSERT_FALSE(automaton.canMatch(feed(automaton, "xx")));
+    ASSERT_FALSE(automaton.canMatch(feed(automaton, "dreamxx")));
+
+    LevenshteinAutomaton exact("abc", 0);
+    ASSERT_TRUE(exact.isMatch(feed(exact, "abc")));
+    ASSERT_FALSE(exact.canMatch(feed(exact, "abd")));
+}
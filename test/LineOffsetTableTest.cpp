@@ -0,0 +1,55 @@
+#include "gtest/gtest.h"
+#include "darwin.hpp"
+#include "LineOffsetTable.hpp"
+#include "IndexBuilder.hpp"
+#include <string>
+#include <vector>
+
+using namespace Darwin;
+using namespace std;
+
+TEST(LineOffsetTableTest, Lookup) {
+    vector<size_t> offsets;
+    LineOffsetTable table;
+    size_t offset = 0;
+    for (size_t lineno = 0; lineno < 1000; lineno++) {
+        offsets.push_back(offset);
+        table.append(offset);
+        // mostly short lines and now and then one far longer than a varint byte
+        offset += 1 + (lineno % 7 == 0 ? 100000 : lineno % 50);
+    }
+    ASSERT_EQ(table.size(), offsets.size());
+    for (size_t lineno = 0; lineno < offsets.size(); lineno++) {
+        ASSERT_EQ(table[lineno], offsets[lineno]);
+    }
+    ASSERT_EQ(table.samples().size(), 2 * ((offsets.size() + LineOffsetTableRef::sampleRate - 1) / LineOffsetTableRef::sampleRate));
+    ASSERT_LT(table.data().size() + table.samples().size() * sizeof(uint64_t), offsets.size() * sizeof(size_t) / 2);
+}
+
+TEST(LineOffsetTableTest, Serialization) {
+    const string fname = "dump/line_offset_table";
+    LineOffsetTable table;
+    for (size_t offset = 0; offset < 100; offset++) table.append(offset * offset);
+    Serializer serializer;
+
+    serializer.serialize(fname, table);
+    LineOffsetTable backupTable;
+    serializer.deserialize(fname, backupTable);
+    ASSERT_EQ(table, backupTable);
+
+    // appending goes on from the last offset
+    table.append(20000);
+    backupTable.append(20000);
+    ASSERT_EQ(table, backupTable);
+    ASSERT_EQ(backupTable[100], 20000);
+}
+
+TEST(LineOffsetTableTest, IndexBuilder) {
+    IndexBuilder indexBuilder((Tokenizer()));
+    indexBuilder.build("data/documents");
+    // doc1 is "shell code\nharry potter"
+    const auto& lineOffsets = indexBuilder.lineOffsets();
+    ASSERT_EQ(lineOffsets.size(), 4);
+    ASSERT_EQ(lineOffsets[0][0], 0);
+    ASSERT_EQ(lineOffsets[0][1], 11);
+}
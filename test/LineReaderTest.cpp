@@ -0,0 +1,53 @@
+#include "gtest/gtest.h"
+#include "darwin.hpp"
+#include "LineReader.hpp"
+#include <string>
+#include <vector>
+#include <fstream>
+
+using namespace Darwin;
+using namespace std;
+
+TEST(LineReaderTest, LinesAndOffsets) {
+    const string fname = "dump/line_reader";
+    vector<string> lines = {"shell code", "", "harry potter", string(100, 'x'), "", "i have a dream"};
+    vector<size_t> expOffsets;
+    {
+        ofstream fout(fname, ios_base::out | ios_base::binary);
+        size_t offset = 0;
+        for (size_t i = 0; i < lines.size(); i++) {
+            expOffsets.push_back(offset);
+            fout << lines[i];
+            offset += lines[i].length();
+            // the last line has no newline
+            if (i + 1 != lines.size()) {
+                fout << "\n";
+                offset += 1;
+            }
+        }
+    }
+
+    // tiny blocks force refills and a line longer than the buffer
+    for (size_t blockSize : {1, 7, 64, 1 << 20}) {
+        LineReader reader(fname, blockSize);
+        ASSERT_TRUE(reader.is_open());
+
+        StringRef line;
+        size_t offset;
+        for (size_t i = 0; i < lines.size(); i++) {
+            ASSERT_TRUE(reader.next(line, offset));
+            ASSERT_EQ(line.str(), lines[i]);
+            ASSERT_EQ(offset, expOffsets[i]);
+        }
+        ASSERT_FALSE(reader.next(line, offset));
+    }
+}
+
+TEST(LineReaderTest, MissingFile) {
+    LineReader reader("dump/no_such_file");
+    ASSERT_FALSE(reader.is_open());
+
+    StringRef line;
+    size_t offset;
+    ASSERT_FALSE(reader.next(line, offset));
+}
@@ -0,0 +1,71 @@
+#include "gtest/gtest.h"
+#include "darwin.hpp"
+#include "LineSearch.hpp"
+#include "IndexBuilder.hpp"
+#include "MappedIndex.hpp"
+#include "LazyIndex.hpp"
+#include "FrozenIndex.hpp"
+#include <string>
+#include <vector>
+
+using namespace Darwin;
+using namespace std;
+
+namespace {
+    template <typename Cursor>
+    SearchResultType drain(Cursor cursor) {
+        SearchResultType result;
+        while (!cursor.done()) result.push_back(cursor.next());
+        return result;
+    }
+}
+
+TEST(LineSearchTest, FindSorted) {
+    vector<string> words = {"a", "ab", "b", "harry", "potter"};
+    auto wordAt = [&words] (size_t i) { return StringRef(words[i]); };
+    for (size_t i = 0; i < words.size(); i++) ASSERT_EQ(findSorted(words.size(), words[i], wordAt), i);
+    for (const string word : {"", "aa", "c", "zzz"}) ASSERT_EQ(findSorted(words.size(), word, wordAt), words.size());
+    ASSERT_EQ(findSorted(0, "a", wordAt), 0);
+}
+
+TEST(LineSearchTest, LineStatistics) {
+    LineStatistics statistics;
+    for (size_t length : {3, 0, 5, 2}) statistics.add(length);
+    ASSERT_EQ(statistics.lineNum, 4);
+    ASSERT_EQ(statistics.totalLength, 10);
+    ASSERT_EQ(statistics.minLength, 2);
+    ASSERT_DOUBLE_EQ(statistics.avgLength(), 2.5);
+}
+
+TEST(LineSearchTest, SameAcrossIndexes) {
+    IndexBuilder indexBuilder((Tokenizer()));
+    indexBuilder.build("data/documents");
+    MappedIndex::write("dump/line_search_mapped", indexBuilder);
+    MappedIndex mapped("dump/line_search_mapped");
+    Serializer serializer;
+    serializer.serialize("dump/line_search_index", indexBuilder);
+    LazyIndex lazy("dump/line_search_index");
+    FrozenIndex frozen = indexBuilder.freeze();
+
+    for (const string word : {"harry", "dream", "nothing"}) {
+        auto expected = indexBuilder.search(word);
+        ASSERT_EQ(mapped.search(word), expected);
+        ASSERT_EQ(lazy.search(word), expected);
+        ASSERT_EQ(frozen.search(word), expected);
+        ASSERT_EQ(drain(mapped.searchCursor(word)), expected);
+        ASSERT_EQ(drain(lazy.searchCursor(word)), expected);
+        ASSERT_EQ(drain(frozen.searchCursor(word)), expected);
+    }
+    Query query = Query::parse("have AND (dream OR you)");
+    ASSERT_EQ(mapped.search(query), indexBuilder.search(query));
+    ASSERT_EQ(drain(lazy.searchCursor(query, 1)), drain(indexBuilder.searchCursor(query, 1)));
+
+    auto ranked = indexBuilder.searchTopK("harry dream dream", 3);
+    auto frozenRanked = frozen.searchTopK("harry dream dream", 3);
+    ASSERT_EQ(ranked.size(), 3);
+    ASSERT_EQ(frozenRanked.size(), ranked.size());
+    for (size_t i = 0; i < ranked.size(); i++) {
+        ASSERT_DOUBLE_EQ(frozenRanked[i].score, ranked[i].score);
+        ASSERT_EQ(frozenRanked[i].result, ranked[i].result);
+    }
+}
@@ -0,0 +1,61 @@
+#include "gtest/gtest.h"
+#include "darwin.hpp"
+#include "IndexBuilder.hpp"
+#include "MappedIndex.hpp"
+#include <string>
+#include <vector>
+#include <fstream>
+
+using namespace Darwin;
+using namespace std;
+
+TEST(MappedIndexTest, Documents) {
+    const string fname = "dump/mapped_index";
+    IndexBuilder indexBuilder((Tokenizer()));
+    indexBuilder.build("data/documents");
+    MappedIndex::write(fname, indexBuilder);
+
+    MappedIndex index(fname);
+    ASSERT_EQ(index.documentNum(), 4);
+    ASSERT_EQ(index.termNum(), 10);
+    ASSERT_EQ(index.dataDirectory().str(), "data/");
+    vector<string> expDocList = {"doc1", "doc2", "doc3", "doc4"};
+    for (size_t i = 0; i < expDocList.size(); i++) {
+        ASSERT_EQ(index.documentName(i).str(), expDocList[i]);
+    }
+}
+
+TEST(MappedIndexTest, Search) {
+    const string fname = "dump/mapped_index";
+    IndexBuilder indexBuilder((Tokenizer()));
+    indexBuilder.build("data/documents");
+    MappedIndex::write(fname, indexBuilder);
+
+    MappedIndex index(fname);
+    vector<string> keys = {"shell", "code", "harry", "potter", "i", "have", "a", "dream", "do", "you", "ruochen", ""};
+    for (const auto& key : keys) {
+        ASSERT_EQ(index.search(key), indexBuilder.search(key));
+    }
+
+    vector<string> queries = {"harry AND potter", "have AND NOT you", "shell OR dream"};
+    for (const auto& query : queries) {
+        ASSERT_EQ(index.search(Query::parse(query)), indexBuilder.search(Query::parse(query)));
+    }
+    ASSERT_THROW(index.search(Query::parse("dr*")), InvalidQuery);
+    ASSERT_THROW(index.search(Query::parse("harry AND poter~")), InvalidQuery);
+
+    auto postings = index.postings("dream");
+    PostingList expPostings = {{2, 0}, {3, 0}};
+    ASSERT_EQ(postings.size(), expPostings.size());
+    ASSERT_TRUE(equal(postings.begin(), postings.end(), expPostings.begin()));
+}
+
+TEST(MappedIndexTest, InvalidFile) {
+    const string fname = "dump/not_mapped_index";
+    ofstream fout(fname, ios_base::out | ios_base::binary);
+    fout << "not an index, but long enough to hold a header of the mapped index";
+    fout.close();
+
+    ASSERT_THROW(MappedIndex index(fname), MappedIndexError);
+    ASSERT_THROW(MappedIndex index("dump/no_such_index"), MappedIndexError);
+}
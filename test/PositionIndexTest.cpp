@@ -0,0 +1,117 @@
+#include "gtest/gtest.h"
+#include "darwin.hpp"
+#include "PositionIndex.hpp"
+#include "IndexBuilder.hpp"
+#include "Corpus.hpp"
+#include <string>
+#include <vector>
+#include <sstream>
+
+using namespace Darwin;
+using namespace std;
+
+namespace {
+    const size_t docNum = 8;
+
+    void writeCorpus() {
+        ::writeCorpus("position", docNum, 30, [] (size_t d, size_t lineno) {
+            string line;
+            for (size_t w = 0; w < 8; w++) line += (w ? " w" : "w") + to_string((d * 31 + lineno * 7 + w * w) % 5);
+            return line;
+        });
+    }
+
+    // the lines where match accepts the words of the line
+    template <typename Match>
+    SearchResultType scan(Match match) {
+        return scanCorpus("position", docNum, [&match] (const string& line) {
+            vector<string> words;
+            istringstream in(line);
+            for (string word; in >> word; ) words.push_back(word);
+            return match(words);
+        });
+    }
+}
+
+TEST(PositionIndexTest, Cursor) {
+    PositionIndex index;
+    PositionType first[] = {0, 3, 200};
+    PositionType second[] = {5};
+    PositionType third[] = {1, 2};
+    index.add(7, first, 3);
+    index.add(7, second, 1);
+    index.add(7, third, 2);
+    PostingList postings = {{0, 0, 3}, {0, 4, 1}, {2, 1, 2}};
+
+    PositionCursor<PostingList> cursor(postings, *index.find(7));
+    vector<PositionType> positions;
+    ASSERT_TRUE(cursor.seek({0, 0}, positions));
+    ASSERT_EQ(positions, vector<PositionType>({0, 3, 200}));
+    ASSERT_FALSE(cursor.seek({0, 2}, positions));
+    ASSERT_TRUE(positions.empty());
+    ASSERT_TRUE(cursor.seek({2, 1}, positions));
+    ASSERT_EQ(positions, vector<PositionType>({1, 2}));
+    ASSERT_FALSE(cursor.seek({3, 0}, positions));
+    ASSERT_EQ(index.find(8), nullptr);
+}
+
+TEST(PositionIndexTest, Phrase) {
+    IndexBuilder indexBuilder((Tokenizer()));
+    indexBuilder.build("data/documents", 1, false, true);
+    ASSERT_TRUE(indexBuilder.hasPositions());
+
+    SearchResultType harry = {Result(0, "doc1", 1, "harry potter"), Result(1, "doc2", 0, "harry potter")};
+    SearchResultType dream = {Result(2, "doc3", 0, "i have a dream"), Result(3, "doc4", 0, "do you have a dream")};
+    ASSERT_EQ(indexBuilder.searchPhrase("harry potter"), harry);
+    ASSERT_TRUE(indexBuilder.searchPhrase("potter harry").empty());
+    ASSERT_EQ(indexBuilder.searchPhrase("have a dream"), dream);
+    ASSERT_EQ(indexBuilder.searchPhrase("i have"), SearchResultType({dream[0]}));
+    ASSERT_TRUE(indexBuilder.searchPhrase("have dream").empty());
+    ASSERT_TRUE(indexBuilder.searchPhrase("harry zzz").empty());
+
+    ASSERT_EQ(indexBuilder.searchNear("do", "have", 2), SearchResultType({dream[1]}));
+    ASSERT_TRUE(indexBuilder.searchNear("do", "have", 1).empty());
+    ASSERT_EQ(indexBuilder.searchNear("dream", "have", 2), dream);
+    ASSERT_TRUE(indexBuilder.searchNear("dream", "dream", 5).empty());
+
+    IndexBuilder plain((Tokenizer()));
+    plain.build("data/documents");
+    ASSERT_THROW(plain.searchPhrase("harry potter"), InvalidQuery);
+}
+
+TEST(PositionIndexTest, SameAsScan) {
+    writeCorpus();
+    IndexBuilder indexBuilder((Tokenizer()));
+    indexBuilder.build("dump/position_documents", 1, false, true);
+    IndexBuilder parallel((Tokenizer()));
+    parallel.build("dump/position_documents", 3, false, true);
+    ASSERT_TRUE(parallel == indexBuilder);
+
+    for (const string phrase : {"w1 w2", "w0 w0", "w3 w4 w2", "w1 w1 w1"}) {
+        vector<string> phraseWords = indexBuilder.tokenizer().split(phrase);
+        auto expected = scan([&phraseWords] (const vector<string>& words) {
+            return search(words.begin(), words.end(), phraseWords.begin(), phraseWords.end()) != words.end();
+        });
+        ASSERT_EQ(indexBuilder.searchPhrase(phrase), expected);
+    }
+
+    for (size_t k : {1, 2, 4}) {
+        auto expected = scan([k] (const vector<string>& words) {
+            for (size_t i = 0; i < words.size(); i++) {
+                for (size_t j = 0; j < words.size(); j++) {
+                    size_t gap = (i > j ? i - j : j - i);
+                    if (i != j && gap <= k && words[i] == "w0" && words[j] == "w3") return true;
+                }
+            }
+            return false;
+        });
+        ASSERT_EQ(indexBuilder.searchNear("w0", "w3", k), expected);
+    }
+
+    Serializer serializer;
+    serializer.serialize("dump/position_index", indexBuilder);
+    IndexBuilder loaded((Tokenizer()));
+    serializer.deserialize("dump/position_index", loaded);
+    ASSERT_TRUE(loaded == indexBuilder);
+    ASSERT_EQ(loaded.searchPhrase("w1 w2"), indexBuilder.searchPhrase("w1 w2"));
+}
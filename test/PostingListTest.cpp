@@ -0,0 +1,104 @@
+#include "gtest/gtest.h"
+#include "darwin.hpp"
+#include "PostingList.hpp"
+#include <string>
+#include <vector>
+
+using namespace Darwin;
+using namespace std;
+
+TEST(PostingListTest, VarByte) {
+    vector<size_t> values = {0, 1, 127, 128, 300, 16383, 16384, (size_t)1 << 40};
+    vector<unsigned char> buf;
+    for (const auto& v : values) {
+        VarByte::encode(buf, v);
+    }
+
+    const unsigned char* pos = buf.data();
+    for (const auto& v : values) {
+        ASSERT_EQ(VarByte::decode(pos), v);
+    }
+    ASSERT_EQ(pos, buf.data() + buf.size());
+}
+
+TEST(PostingListTest, AppendAndIterate) {
+    vector<InvertedIndexValueType> postings = {
+        {0, 0}, {0, 1}, {0, 20, 4}, {3, 0}, {3, 5, 2}, {1000, 9999, 300}
+    };
+
+    PostingList list;
+    for (const auto& p : postings) {
+        list.append(p);
+    }
+    ASSERT_EQ(list.size(), postings.size());
+
+    vector<InvertedIndexValueType> decoded(list.begin(), list.end());
+    ASSERT_EQ(decoded, postings);
+}
+
+TEST(PostingListTest, DropRepeatedLine) {
+    PostingList list;
+    list.append({2, 1});
+    list.append({2, 1});
+    list.append({2, 2});
+    list.append({2, 2});
+    ASSERT_EQ(list.size(), 2);
+
+    PostingList expList = {{2, 2}, {2, 1}};
+    ASSERT_EQ(list, expList);
+}
+
+TEST(PostingListTest, CompactEncoding) {
+    PostingList list;
+    for (PositionType lineno = 0; lineno < 1000; lineno++) {
+        list.append({lineno / 100, lineno, 1 + lineno % 3});
+    }
+    ASSERT_EQ(list.size(), 1000);
+    // doc delta, line delta and tf take a byte each, far below three raw words per posting
+    ASSERT_LE(list.bytes(), 3 * list.size() + 10);
+}
+
+TEST(PostingListTest, Serialization) {
+    const string fname = "dump/posting_list";
+    PostingList list = {{0, 0}, {0, 1}, {1, 0}, {7, 12}};
+    Serializer serializer;
+
+    serializer.serialize(fname, list);
+    PostingList backupList;
+    serializer.deserialize(fname, backupList);
+    ASSERT_EQ(list, backupList);
+
+    backupList.append({8, 0});
+    list.append({8, 0});
+    ASSERT_EQ(list, backupList);
+}
+
+TEST(PostingListTest, AppendList) {
+    PostingList expList = {{0, 0}, {0, 1}, {2, 1}, {2, 2}, {5, 0}};
+
+    PostingList list = {{0, 0}, {0, 1}};
+    PostingList rhs = {{2, 1}, {2, 2}, {5, 0}};
+    list.append(rhs);
+    ASSERT_EQ(list, expList);
+
+    // a list continuing on the last line of the other one
+    PostingList head = {{0, 0}, {0, 1}, {2, 1}};
+    PostingList tail = {{2, 1}, {2, 2}, {5, 0}};
+    head.append(tail);
+    ASSERT_EQ(head.size(), expList.size());
+    ASSERT_EQ(head, expList);
+}
+
+TEST(PostingListTest, TermFrequency) {
+    PostingList list = {{0, 0, 3}, {0, 1}, {2, 4, 7}};
+    vector<size_t> expTfs = {3, 1, 7};
+    vector<size_t> tfs;
+    for (const auto& p : list) tfs.push_back(p.tf);
+    ASSERT_EQ(tfs, expTfs);
+    ASSERT_EQ(list.maxTf(), 7);
+
+    PostingList tail = {{3, 0, 9}};
+    list.append(tail);
+    ASSERT_EQ(list.maxTf(), 9);
+    ASSERT_EQ(list.last(), InvertedIndexValueType(3, 0, 9));
+}
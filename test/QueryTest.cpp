@@ -0,0 +1,99 @@
+#include "gtest/gtest.h"
+#include "darwin.hpp"
+#include "Query.hpp"
+#include <string>
+#include <vector>
+#include <map>
+
+using namespace Darwin;
+using namespace std;
+
+namespace {
+    PostingVectorType lines(DocIdType docId, const vector<PositionType>& linenos) {
+        PostingVectorType ret;
+        for (auto lineno : linenos) ret.push_back({docId, lineno});
+        return ret;
+    }
+}
+
+TEST(QueryTest, Parse) {
+    Query query = Query::parse("harry AND (potter OR NOT dream) you");
+    ASSERT_EQ(query.type(), Query::AND);
+    ASSERT_EQ(query.children().size(), 3);
+    ASSERT_EQ(query.children()[0].word(), "harry");
+    ASSERT_EQ(query.children()[1].type(), Query::OR);
+    ASSERT_EQ(query.children()[1].children()[1].type(), Query::NOT);
+    ASSERT_EQ(query.children()[1].children()[1].children()[0].word(), "dream");
+    ASSERT_EQ(query.children()[2].word(), "you");
+
+    ASSERT_EQ(Query::parse("a OR b c").type(), Query::OR);
+    ASSERT_THROW(Query::parse("a AND"), InvalidQuery);
+    ASSERT_THROW(Query::parse("(a OR b"), InvalidQuery);
+    ASSERT_THROW(Query::parse("a b)"), InvalidQuery);
+    ASSERT_THROW(Query::parse(""), InvalidQuery);
+}
+
+TEST(QueryTest, Gallop) {
+    PostingVectorType postings = lines(0, {1, 3, 5, 7, 9, 11, 13, 15, 17, 19, 21});
+    for (size_t from = 0; from <= postings.size(); from++) {
+        for (PositionType lineno = 0; lineno <= 22; lineno++) {
+            InvertedIndexValueType target(0, lineno);
+            size_t expPos = lower_bound(postings.begin() + from, postings.end(), target) - postings.begin();
+            ASSERT_EQ(Query::gallop(postings, from, target), expPos);
+        }
+    }
+}
+
+TEST(QueryTest, SetOperations) {
+    PostingVectorType a = lines(0, {1, 2, 3, 5, 8, 13, 21});
+    PostingVectorType b = lines(0, {2, 3, 4, 13, 30});
+
+    ASSERT_EQ(Query::intersect(a, b), lines(0, {2, 3, 13}));
+    ASSERT_EQ(Query::intersect(b, a), lines(0, {2, 3, 13}));
+    ASSERT_EQ(Query::subtract(a, b), lines(0, {1, 5, 8, 21}));
+    ASSERT_EQ(Query::unite(a, b), lines(0, {1, 2, 3, 4, 5, 8, 13, 21, 30}));
+    ASSERT_EQ(Query::intersect(a, PostingVectorType()), PostingVectorType());
+}
+
+TEST(QueryTest, Evaluate) {
+    map<string, PostingVectorType> index = {
+        {"harry", lines(0, {1, 2, 3, 4})},
+        {"potter", lines(0, {2, 4, 6})},
+        {"dream", lines(0, {4, 5})}
+    };
+    auto lookup = [&index] (const string& word) {
+        auto postings = index.find(word);
+        return postings == index.end() ? PostingVectorType() : postings->second;
+    };
+
+    ASSERT_EQ(Query::parse("harry potter").evaluate(lookup), lines(0, {2, 4}));
+    ASSERT_EQ(Query::parse("harry AND NOT potter").evaluate(lookup), lines(0, {1, 3}));
+    ASSERT_EQ(Query::parse("potter OR dream").evaluate(lookup), lines(0, {2, 4, 5, 6}));
+    ASSERT_EQ(Query::parse("harry AND (potter OR dream) AND NOT dream").evaluate(lookup), lines(0, {2}));
+    ASSERT_EQ(Query::parse("harry AND nobody").evaluate(lookup), PostingVectorType());
+    ASSERT_THROW(Query::parse("NOT harry").evaluate(lookup), InvalidQuery);
+    ASSERT_THROW(Query::parse("harry OR NOT potter").evaluate(lookup), InvalidQuery);
+}
+
+TEST(QueryTest, Patterns) {
+    ASSERT_EQ(Query::fuzzyDistance("dream~"), 1);
+    ASSERT_EQ(Query::fuzzyDistance("dream~1"), 1);
+    ASSERT_EQ(Query::fuzzyDistance("dream~2"), 2);
+    ASSERT_EQ(Query::fuzzyDistance("dream~3"), 0);
+    ASSERT_EQ(Query::fuzzyDistance("~"), 0);
+    ASSERT_EQ(Query::fuzzyDistance("dream"), 0);
+    ASSERT_TRUE(Query::isPattern("conn*"));
+    ASSERT_TRUE(Query::isPattern("h?ve"));
+    ASSERT_TRUE(Query::isPattern("drem~"));
+    ASSERT_FALSE(Query::isPattern("harry"));
+
+    map<string, PostingVectorType> index = {{"harry", lines(0, {1, 2})}, {"c++*", lines(0, {3})}};
+    auto lookup = [&index] (const string& word) {
+        auto postings = index.find(word);
+        return postings == index.end() ? PostingVectorType() : postings->second;
+    };
+    ASSERT_EQ(Query::parse("harry OR c++*").evaluateWords(lookup), lines(0, {1, 2, 3}));
+    ASSERT_EQ(Query::parse("harry nobody").evaluateWords(lookup), PostingVectorType());
+    ASSERT_THROW(Query::parse("harry OR h*").evaluateWords(lookup), InvalidQuery);
+    ASSERT_THROW(Query::parse("hary~").evaluateWords(lookup), InvalidQuery);
+}
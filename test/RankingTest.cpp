@@ -0,0 +1,77 @@
+#include "gtest/gtest.h"
+#include "darwin.hpp"
+#include "PostingList.hpp"
+#include "Ranking.hpp"
+#include <vector>
+#include <map>
+#include <random>
+#include <algorithm>
+
+using namespace Darwin;
+using namespace std;
+
+TEST(RankingTest, BM25) {
+    BM25 bm25;
+    // rarer words and more occurrences score higher, longer lines lower
+    ASSERT_GT(bm25.idf(100, 1), bm25.idf(100, 50));
+    ASSERT_GT(bm25.idf(100, 100), 0);
+    double idf = bm25.idf(100, 10);
+    ASSERT_GT(bm25.score(idf, 2, 10, 10), bm25.score(idf, 1, 10, 10));
+    ASSERT_GT(bm25.score(idf, 1, 5, 10), bm25.score(idf, 1, 20, 10));
+    ASSERT_LT(bm25.score(idf, 1000, 10, 10), idf * (bm25.k1 + 1));
+}
+
+TEST(RankingTest, WandMatchesExhaustiveScoring) {
+    const size_t docNum = 20;
+    const size_t lineNum = 50;
+    mt19937 rng(7);
+
+    vector<vector<uint32_t>> lengths(docNum, vector<uint32_t>(lineNum));
+    size_t totalLength = 0;
+    for (auto& doc : lengths) {
+        for (auto& length : doc) {
+            length = 5 + rng() % 20;
+            totalLength += length;
+        }
+    }
+    double avgLength = static_cast<double>(totalLength) / (docNum * lineNum);
+    auto lineLength = [&lengths] (DocIdType docId, size_t lineno) { return lengths[docId][lineno]; };
+
+    // a frequent, a medium and a rare word
+    vector<PostingList> lists(3);
+    for (DocIdType docId = 0; docId < docNum; docId++) {
+        for (PositionType lineno = 0; lineno < lineNum; lineno++) {
+            if (rng() % 2 == 0) lists[0].append(InvertedIndexValueType(docId, lineno, 1 + rng() % 2));
+            if (rng() % 10 == 0) lists[1].append(InvertedIndexValueType(docId, lineno, 1 + rng() % 3));
+            if (rng() % 100 == 0) lists[2].append(InvertedIndexValueType(docId, lineno, 1 + rng() % 4));
+        }
+    }
+
+    BM25 bm25;
+    vector<Wand<PostingListRef>::Term> terms;
+    for (const auto& list : lists) {
+        double idf = bm25.idf(docNum * lineNum, list.size());
+        terms.push_back({list.ref(), idf, bm25.score(idf, list.maxTf(), 5, avgLength)});
+    }
+
+    map<InvertedIndexValueType, double> scores;
+    for (const auto& term : terms) {
+        for (const auto& p : term.postings) {
+            scores[InvertedIndexValueType(p.docId, p.lineno)] += bm25.score(term.idf, p.tf, lineLength(p.docId, p.lineno), avgLength);
+        }
+    }
+    vector<ScoredPosting> expected;
+    for (const auto& s : scores) expected.push_back(ScoredPosting(s.first, s.second));
+    sort(expected.begin(), expected.end());
+
+    for (size_t k : {size_t(1), size_t(10), size_t(100), expected.size() + 1}) {
+        auto result = Wand<PostingListRef>(bm25, avgLength).topK(terms, k, lineLength);
+        ASSERT_EQ(result.size(), min(k, expected.size()));
+        for (size_t i = 0; i < result.size(); i++) {
+            ASSERT_EQ(result[i].posting.docId, expected[i].posting.docId);
+            ASSERT_EQ(result[i].posting.lineno, expected[i].posting.lineno);
+            ASSERT_DOUBLE_EQ(result[i].score, expected[i].score);
+        }
+    }
+    ASSERT_TRUE(Wand<PostingListRef>(bm25, avgLength).topK(terms, 0, lineLength).empty());
+}
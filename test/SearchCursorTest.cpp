@@ -0,0 +1,76 @@
+#include "gtest/gtest.h"
+#include "darwin.hpp"
+#include "SearchCursor.hpp"
+#include "IndexBuilder.hpp"
+#include "MappedIndex.hpp"
+#include <string>
+#include <vector>
+
+using namespace Darwin;
+using namespace std;
+
+namespace {
+    PostingVectorType lines(size_t n) {
+        PostingVectorType ret;
+        for (PositionType lineno = 0; lineno < n; lineno++) ret.push_back({0, lineno, 1 + lineno % 3});
+        return ret;
+    }
+}
+
+TEST(SearchCursorTest, LazyFetch) {
+    size_t fetched = 0;
+    auto fetch = [&fetched] (const InvertedIndexValueType& doc) {
+        fetched += 1;
+        return Result(doc.docId, "doc", doc.lineno, to_string(doc.tf));
+    };
+
+    SearchCursor<PostingVectorType> cursor(lines(100), fetch, 10, 5);
+    ASSERT_EQ(fetched, 0);
+    ASSERT_FALSE(cursor.done());
+    ASSERT_EQ(cursor.next(), Result(0, "doc", 10, "2"));
+    ASSERT_EQ(fetched, 1);
+    ASSERT_EQ(cursor.skip(2), 2);
+    ASSERT_EQ(cursor.next(), Result(0, "doc", 13, "2"));
+    ASSERT_EQ(cursor.next(), Result(0, "doc", 14, "3"));
+    ASSERT_TRUE(cursor.done());
+    ASSERT_EQ(fetched, 3);
+
+    // forEach stops as soon as the callback returns false
+    SearchCursor<PostingVectorType> all(lines(100), fetch);
+    size_t calls = all.forEach([] (const Result& result) { return result.lineno < 2; });
+    ASSERT_EQ(calls, 3);
+    ASSERT_EQ(fetched, 6);
+
+    SearchCursor<PostingVectorType> past(lines(3), fetch, 5);
+    ASSERT_TRUE(past.done());
+}
+
+TEST(SearchCursorTest, Pagination) {
+    IndexBuilder indexBuilder((Tokenizer()));
+    indexBuilder.build("data/documents");
+    const string fname = "dump/cursor_index";
+    MappedIndex::write(fname, indexBuilder);
+    MappedIndex index(fname);
+
+    SearchResultType expResult = indexBuilder.search(Query::parse("have OR harry"));
+    ASSERT_EQ(expResult.size(), 4);
+    for (size_t offset = 0; offset <= expResult.size(); offset++) {
+        for (size_t limit = 0; limit <= 2; limit++) {
+            SearchResultType page;
+            indexBuilder.searchCursor(Query::parse("have OR harry"), offset, limit).forEach(
+                [&page] (const Result& result) { page.push_back(result); return true; });
+            size_t last = min(offset + limit, expResult.size());
+            ASSERT_EQ(page, SearchResultType(expResult.begin() + offset, expResult.begin() + last));
+
+            SearchResultType mappedPage;
+            auto cursor = index.searchCursor(Query::parse("have OR harry"), offset, limit);
+            while (!cursor.done()) mappedPage.push_back(cursor.next());
+            ASSERT_EQ(mappedPage, page);
+        }
+    }
+
+    auto cursor = indexBuilder.searchCursor("harry", 1);
+    ASSERT_EQ(cursor.next(), Result(1, "doc2", 0, "harry potter"));
+    ASSERT_TRUE(cursor.done());
+    ASSERT_TRUE(indexBuilder.searchCursor("ruochen").done());
+}
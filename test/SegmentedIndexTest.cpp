@@ -0,0 +1,100 @@
+#include "gtest/gtest.h"
+#include "darwin.hpp"
+#include "IndexBuilder.hpp"
+#include "SegmentedIndex.hpp"
+#include <string>
+#include <vector>
+#include <fstream>
+#include <cstdio>
+
+using namespace Darwin;
+using namespace std;
+
+namespace {
+    void writeDocument(const string& fname, const string& content) {
+        ofstream fout("dump/" + fname, ios_base::out | ios_base::binary);
+        fout << content;
+    }
+}
+
+TEST(SegmentedIndexTest, Build) {
+    IndexBuilder indexBuilder((Tokenizer()));
+    indexBuilder.build("data/documents");
+    SegmentedIndex index("data", Tokenizer());
+    index.build("data/documents");
+    ASSERT_EQ(index.documentNum(), 4);
+    ASSERT_EQ(index.segmentNum(), 1);
+
+    vector<string> keys = {"shell", "code", "harry", "potter", "i", "have", "a", "dream", "do", "you", "ruochen", ""};
+    for (const auto& key : keys) {
+        ASSERT_EQ(index.search(key), indexBuilder.search(key));
+    }
+    ASSERT_EQ(index.search(Query::parse("have AND NOT you")), indexBuilder.search(Query::parse("have AND NOT you")));
+}
+
+TEST(SegmentedIndexTest, AddUpdateRemove) {
+    SegmentedIndex index("dump", Tokenizer());
+    writeDocument("segment_a", "harry potter\nshell code\n");
+    writeDocument("segment_b", "harry and ron\n");
+    ASSERT_EQ(index.addDocument("segment_a"), 0);
+    ASSERT_EQ(index.addDocument("segment_b"), 1);
+    ASSERT_EQ(index.segmentNum(), 2);
+
+    SearchResultType expResult = {{0, "segment_a", 0, "harry potter"}, {1, "segment_b", 0, "harry and ron"}};
+    ASSERT_EQ(index.search("harry"), expResult);
+
+    // the old postings of segment_a are masked, the new ones get a new doc id
+    writeDocument("segment_a", "shell code\nharry potter\n");
+    ASSERT_EQ(index.updateDocument("segment_a"), 2);
+    SearchResultType expUpdatedResult = {{1, "segment_b", 0, "harry and ron"}, {2, "segment_a", 1, "harry potter"}};
+    ASSERT_EQ(index.search("harry"), expUpdatedResult);
+    ASSERT_EQ(index.documentNum(), 2);
+
+    ASSERT_TRUE(index.removeDocument("segment_b"));
+    ASSERT_FALSE(index.removeDocument("segment_b"));
+    SearchResultType expRemovedResult = {{2, "segment_a", 1, "harry potter"}};
+    ASSERT_EQ(index.search("harry"), expRemovedResult);
+    ASSERT_TRUE(index.search("ron").empty());
+    ASSERT_EQ(index.search(Query::parse("harry OR ron")), expRemovedResult);
+}
+
+TEST(SegmentedIndexTest, UpdateByRename) {
+    SegmentedIndex index("dump", Tokenizer());
+    writeDocument("segment_renamed", "alpha beta\n");
+    index.addDocument("segment_renamed");
+    ASSERT_EQ(index.search("alpha"), SearchResultType({{0, "segment_renamed", 0, "alpha beta"}}));
+
+    // an atomic write: the new content is renamed over the old file
+    writeDocument("segment_renamed.tmp", "gamma\nalpha\n");
+    ASSERT_EQ(rename("dump/segment_renamed.tmp", "dump/segment_renamed"), 0);
+    index.updateDocument("segment_renamed");
+    ASSERT_EQ(index.search("gamma"), SearchResultType({{1, "segment_renamed", 0, "gamma"}}));
+    ASSERT_EQ(index.search("alpha"), SearchResultType({{1, "segment_renamed", 1, "alpha"}}));
+}
+
+TEST(SegmentedIndexTest, Merge) {
+    SegmentedIndex index("dump", Tokenizer(), 2);
+    SearchResultType expResult;
+    for (DocIdType i = 0; i < 20; i++) {
+        string docName = "segment_merge_" + to_string(i);
+        writeDocument(docName, "line " + to_string(i) + "\nharry potter\n");
+        index.addDocument(docName);
+        expResult.push_back({i, docName, 1, "harry potter"});
+    }
+    index.waitForMerge();
+    ASSERT_LE(index.segmentNum(), 3);
+    ASSERT_EQ(index.search("potter"), expResult);
+
+    for (size_t i = 0; i < 20; i += 2) {
+        index.removeDocument("segment_merge_" + to_string(i));
+    }
+    index.merge();
+    ASSERT_EQ(index.segmentNum(), 1);
+    ASSERT_EQ(index.documentNum(), 10);
+
+    SearchResultType expOddResult;
+    for (size_t i = 1; i < 20; i += 2) expOddResult.push_back(expResult[i]);
+    ASSERT_EQ(index.search("potter"), expOddResult);
+    ASSERT_TRUE(index.search("0").empty());
+    ASSERT_EQ(index.search("1").size(), 1);
+}
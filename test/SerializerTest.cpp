@@ -93,3 +93,62 @@ TEST(SerializerTest, SerializationOfSpecifiedType) {
     serializer.deserialize(fname, bsiivt);
     ASSERT_EQ(siivt, bsiivt);
 }
+
+TEST(SerializerTest, SerializationOfBulkVectors) {
+    Serializer4Test serializer;
+    const string fname= "dump/bulk_vector";
+
+    vector<double> vd = {0.5, -1.25, 3e100};
+    serializer.serialize(fname, vd);
+    vector<double> bvd = {42};
+    serializer.deserialize(fname, bvd);
+    ASSERT_EQ(vd, bvd);
+
+    vector<bool> vb = {true, false, true};
+    serializer.serialize(fname, vb);
+    vector<bool> bvb;
+    serializer.deserialize(fname, bvb);
+    ASSERT_EQ(vb, bvb);
+
+    string sz("nul\0inside", 10);
+    serializer.serialize(fname, sz);
+    string bsz;
+    serializer.deserialize(fname, bsz);
+    ASSERT_EQ(sz, bsz);
+
+    // the block written for a vector of postings matches the field by field format
+    vector<InvertedIndexValueType> viivt = {{10, 20, 30}, {20, 30, 40}};
+    VectorSink bulk;
+    serializer.serialize(bulk, viivt);
+    VectorSink fields;
+    serializer.serialize(fields, viivt.size());
+    for (const auto& v : viivt) serializer.serialize(fields, v);
+    ASSERT_EQ(bulk.data(), fields.data());
+
+    MemorySource source(bulk.data());
+    vector<InvertedIndexValueType> bviivt;
+    serializer.deserialize(source, bviivt);
+    ASSERT_EQ(viivt, bviivt);
+}
+
+TEST(SerializerTest, IdWidths) {
+    Serializer serializer;
+    VectorSink sink;
+    serializer.serialize(sink, IdWidths());
+    ASSERT_EQ(sink.data().size(), 3);
+    MemorySource source(sink.data());
+    IdWidths widths;
+    ASSERT_NO_THROW(serializer.deserialize(source, widths));
+
+    // an index written by a build with other widths is refused
+    IdWidths wide;
+    wide.docId = 2 * sizeof(DocIdType);
+    VectorSink wideSink;
+    serializer.serialize(wideSink, wide);
+    MemorySource wideSource(wideSink.data());
+    ASSERT_THROW(serializer.deserialize(wideSource, widths), IdWidthMismatch);
+
+#ifndef DARWIN_WIDE_IDS
+    ASSERT_EQ(sizeof(InvertedIndexValueType), 12);
+#endif
+}
@@ -0,0 +1,185 @@
+#include "gtest/gtest.h"
+#include "darwin.hpp"
+#include "Tokenizer.hpp"
+#include "TermDictionary.hpp"
+#include "IndexBuilder.hpp"
+#include <string>
+#include <vector>
+#include <algorithm>
+
+using namespace Darwin;
+using namespace std;
+
+namespace {
+    Tokenizer makeTokenizer(const vector<string>& words) {
+        Tokenizer tokenizer;
+        for (const auto& word : words) tokenizer.tokenize(word);
+        return tokenizer;
+    }
+
+    vector<string> expandWords(const TermDictionary& terms, const Tokenizer& tokenizer, const string& pattern) {
+        vector<string> ret;
+        for (auto wordId : terms.expand(pattern)) {
+            tokenizer.forEachWord([&ret, wordId] (StringRef word, WordIdType id) {
+                if (id == wordId) ret.push_back(word.str());
+            });
+        }
+        sort(ret.begin(), ret.end());
+        return ret;
+    }
+}
+
+TEST(TermDictionaryTest, Order) {
+    vector<string> words;
+    for (size_t i = 0; i < 100; i++) words.push_back("w" + to_string(i * 7919 % 1000));
+    words.push_back("conn");
+    words.push_back("connect");
+    words.push_back("connection");
+    Tokenizer tokenizer = makeTokenizer(words);
+    TermDictionary terms(tokenizer);
+    ASSERT_EQ(terms.size(), words.size());
+
+    sort(words.begin(), words.end());
+    for (size_t i = 0; i < words.size(); i++) {
+        ASSERT_EQ(terms.word(i), words[i]);
+        ASSERT_EQ(terms.wordId(i), tokenizer.getWordId(words[i]));
+        ASSERT_EQ(terms.lowerBound(words[i]), i);
+    }
+    ASSERT_EQ(terms.lowerBound(""), 0);
+    ASSERT_EQ(terms.lowerBound("conne"), 1);
+    ASSERT_EQ(terms.lowerBound("zzz"), words.size());
+    ASSERT_TRUE(TermDictionary().empty());
+    ASSERT_EQ(TermDictionary().lowerBound("a"), 0);
+}
+
+TEST(TermDictionaryTest, Expand) {
+    Tokenizer tokenizer = makeTokenizer({"conn", "connect", "connection", "cone", "con", "disconnect", "reconnect", "c"});
+    TermDictionary terms(tokenizer);
+
+    ASSERT_EQ(expandWords(terms, tokenizer, "conn*"), vector<string>({"conn", "connect", "connection"}));
+    ASSERT_EQ(expandWords(terms, tokenizer, "con?"), vector<string>({"cone", "conn"}));
+    ASSERT_EQ(expandWords(terms, tokenizer, "*connect"), vector<string>({"connect", "disconnect", "reconnect"}));
+    ASSERT_EQ(expandWords(terms, tokenizer, "c*n*t"), vector<string>({"connect"}));
+    ASSERT_EQ(expandWords(terms, tokenizer, "cone"), vector<string>({"cone"}));
+    ASSERT_EQ(expandWords(terms, tokenizer, "x*"), vector<string>());
+    ASSERT_EQ(expandWords(terms, tokenizer, "*").size(), 8);
+
+    ASSERT_TRUE(TermDictionary::match("a*b?c", "axxbyc"));
+    ASSERT_TRUE(TermDictionary::match("**", ""));
+    ASSERT_FALSE(TermDictionary::match("a*b", "abc"));
+    ASSERT_FALSE(TermDictionary::match("?", ""));
+}
+
+TEST(TermDictionaryTest, Bytes) {
+    WordDictionary words;
+    Tokenizer tokenizer;
+    for (size_t i = 0; i < 10000; i++) {
+        string word = "prefix_word" + to_string(i);
+        tokenizer.tokenize(word);
+        words.insert(word, i + 1);
+    }
+    TermDictionary terms(tokenizer);
+    ASSERT_LT(terms.bytes(), words.arenaBytes());
+}
+
+TEST(TermDictionaryTest, SearchWildcard) {
+    IndexBuilder indexBuilder((Tokenizer()));
+    indexBuilder.build("data/documents");
+    ASSERT_EQ(indexBuilder.terms().size(), indexBuilder.tokenizer().wordNum());
+
+    SearchResultType expected = {
+        Result(2, "doc3", 0, "i have a dream"),
+        Result(3, "doc4", 0, "do you have a dream"),
+    };
+    ASSERT_EQ(indexBuilder.searchWildcard("dr*"), expected);
+    ASSERT_EQ(indexBuilder.searchWildcard("d*"), expected);
+    ASSERT_EQ(indexBuilder.searchWildcard("h?ve"), expected);
+    ASSERT_EQ(indexBuilder.searchWildcard("h*"), SearchResultType({
+        Result(0, "doc1", 1, "harry potter"),
+        Result(1, "doc2", 0, "harry potter"),
+        Result(2, "doc3", 0, "i have a dream"),
+        Result(3, "doc4", 0, "do you have a dream"),
+    }));
+    ASSERT_TRUE(indexBuilder.searchWildcard("zz*").empty());
+
+    ASSERT_EQ(indexBuilder.search(Query::parse("h* AND NOT harry")), expected);
+    ASSERT_EQ(indexBuilder.search(Query::parse("s* OR y?u")), SearchResultType({
+        Result(0, "doc1", 0, "shell code"),
+        Result(3, "doc4", 0, "do you have a dream"),
+    }));
+
+    Serializer serializer;
+    serializer.serialize("dump/term_index", indexBuilder);
+    IndexBuilder loaded((Tokenizer()));
+    serializer.deserialize("dump/term_index", loaded);
+    ASSERT_EQ(loaded.searchWildcard("h*"), indexBuilder.searchWildcard("h*"));
+}
+
+TEST(TermDictionaryTest, Fuzzy) {
+    // every word of up to four letters over abc, the automaton has to prune most of them
+    vector<string> words = {""};
+    for (size_t length = 1; length <= 4; length++) {
+        size_t first = words.size();
+        for (size_t i = 0; i < first; i++) {
+            if (words[i].length() != length - 1) continue;
+            for (char c : string("abc")) words.push_back(words[i] + c);
+        }
+    }
+    words.erase(words.begin());
+    Tokenizer tokenizer = makeTokenizer(words);
+    TermDictionary terms(tokenizer);
+
+    auto editDistance = [] (const string& lhs, const string& rhs) {
+        vector<size_t> row(rhs.length() + 1);
+        for (size_t j = 0; j < row.size(); j++) row[j] = j;
+        for (size_t i = 1; i <= lhs.length(); i++) {
+            size_t diagonal = row[0];
+            row[0] = i;
+            for (size_t j = 1; j <= rhs.length(); j++) {
+                size_t cost = min(diagonal + (lhs[i - 1] == rhs[j - 1] ? 0 : 1), min(row[j], row[j - 1]) + 1);
+                diagonal = row[j];
+                row[j] = cost;
+            }
+        }
+        return row.back();
+    };
+
+    for (const string word : {"abc", "cab", "a", "abcab", "bbbb", "x"}) {
+        for (size_t maxDistance : {0, 1, 2}) {
+            vector<string> expected;
+            for (const auto& w : words) {
+                if (editDistance(word, w) <= maxDistance) expected.push_back(w);
+            }
+            sort(expected.begin(), expected.end());
+
+            vector<string> found;
+            terms.forEachFuzzy(word, maxDistance, [&] (StringRef w, WordIdType wordId, size_t distance) {
+                ASSERT_EQ(wordId, tokenizer.getWordId(w));
+                ASSERT_EQ(distance, editDistance(word, w.str()));
+                found.push_back(w.str());
+            });
+            ASSERT_EQ(found, expected);
+            ASSERT_EQ(terms.fuzzy(word, maxDistance).size(), expected.size());
+        }
+    }
+}
+
+TEST(TermDictionaryTest, SearchFuzzy) {
+    IndexBuilder indexBuilder((Tokenizer()));
+    indexBuilder.build("data/documents");
+
+    SearchResultType dream = {
+        Result(2, "doc3", 0, "i have a dream"),
+        Result(3, "doc4", 0, "do you have a dream"),
+    };
+    ASSERT_EQ(indexBuilder.searchFuzzy("drem"), dream);
+    ASSERT_EQ(indexBuilder.searchFuzzy("dreams"), dream);
+    ASSERT_TRUE(indexBuilder.searchFuzzy("drm").empty());
+    ASSERT_EQ(indexBuilder.searchFuzzy("drm", 2), dream);
+    ASSERT_EQ(indexBuilder.searchFuzzy("hary"), indexBuilder.search("harry"));
+    ASSERT_THROW(indexBuilder.searchFuzzy("dream", 3), InvalidQuery);
+
+    ASSERT_EQ(indexBuilder.search(Query::parse("hary~ AND poter~")), indexBuilder.search("harry"));
+    ASSERT_EQ(indexBuilder.search(Query::parse("drm~2 AND NOT yu~")), SearchResultType({dream[0]}));
+    ASSERT_TRUE(indexBuilder.search(Query::parse("drm~")).empty());
+}
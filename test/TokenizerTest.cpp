@@ -38,6 +38,49 @@ TEST(TokenizerTest, SplitByMutiChar) {
     ASSERT_EQ(expWords, words);
 }
 
+TEST(TokenizerTest, SplitRef) {
+    Tokenizer4Test tokenizer;
+    string sentence = "  I have a dream, a very big dream.";
+    vector<string> expWords = {"I", "have", "a", "dream", "a", "very", "big", "dream"};
+    auto words = tokenizer.splitRef(sentence, " ,.");
+    ASSERT_EQ(words.size(), expWords.size());
+    for (size_t i = 0; i < words.size(); i++) {
+        ASSERT_EQ(words[i], StringRef(expWords[i]));
+        // the words are views into the sentence
+        ASSERT_GE(words[i].data(), sentence.data());
+        ASSERT_LE(words[i].data() + words[i].size(), sentence.data() + sentence.size());
+    }
+}
+
+TEST(TokenizerTest, SplitLongSentence) {
+    Tokenizer4Test tokenizer;
+    vector<string> delimsList = {" ", " ,.", " \t,.;:!?()[]{}"};
+    string alphabet = "abcdefgh ,.;:!?()[]{}\t";
+
+    for (const auto& delims : delimsList) {
+        for (size_t length : {0, 1, 15, 16, 17, 31, 32, 33, 100, 1000}) {
+            string sentence;
+            for (size_t i = 0; i < length; i++) {
+                sentence.push_back(alphabet[(i * 7 + length) * 2654435761u % alphabet.size()]);
+            }
+
+            vector<string> expWords;
+            string word;
+            for (auto c : sentence) {
+                if (delims.find(c) == string::npos) {
+                    word.push_back(c);
+                } else if (!word.empty()) {
+                    expWords.push_back(word);
+                    word.clear();
+                }
+            }
+            if (!word.empty()) expWords.push_back(word);
+
+            ASSERT_EQ(expWords, tokenizer.split(sentence, delims));
+        }
+    }
+}
+
 TEST(TokenizerTest, TokenizeBySingleChar) {
     Tokenizer4Test tokenizer;
     string sentence = "I have a dream a very very very big dream Do you have a dream";
@@ -51,6 +94,10 @@ TEST(TokenizerTest, TokenizeBySingleChar) {
         {"very", 5}, {"big", 6}, {"Do", 7}, {"you", 8}
     };
     validator.validateWordMap(tokenizer, wordMap);
+
+    string line = "have a nightmare";
+    ASSERT_EQ(tokenizer.getWordId(StringRef(line.data(), 4)), 2);
+    ASSERT_EQ(tokenizer.getWordId(StringRef(line.data() + 7, 9)), 0);
 }
 
 TEST(TokenizerTest, TokenizeByMultiChar) {
@@ -0,0 +1,119 @@
+#include "gtest/gtest.h"
+#include "darwin.hpp"
+#include "TrigramIndex.hpp"
+#include "IndexBuilder.hpp"
+#include "Corpus.hpp"
+#include <string>
+#include <vector>
+#include <regex>
+
+using namespace Darwin;
+using namespace std;
+
+namespace {
+    const size_t docNum = 12;
+
+    void writeCorpus() {
+        ::writeCorpus("trigram", docNum, 15, [] (size_t d, size_t lineno) {
+            return "id" + to_string(d * 100 + lineno) + " foo_bar" + to_string((d + lineno) % 7) + " x";
+        });
+    }
+
+    template <typename Match>
+    SearchResultType scan(Match match) {
+        return scanCorpus("trigram", docNum, match);
+    }
+}
+
+TEST(TrigramIndexTest, Literals) {
+    ASSERT_EQ(TrigramIndex::literals("foo_bar3"), vector<string>({"foo_bar3"}));
+    ASSERT_EQ(TrigramIndex::literals("foo.*bar"), vector<string>({"foo", "bar"}));
+    ASSERT_EQ(TrigramIndex::literals("ab?cd"), vector<string>({"a", "cd"}));
+    ASSERT_EQ(TrigramIndex::literals("abc+d"), vector<string>({"abc", "d"}));
+    ASSERT_EQ(TrigramIndex::literals("id\\d+ foo"), vector<string>({"id", " foo"}));
+    ASSERT_EQ(TrigramIndex::literals("a\\.b[xyz]cde(f|g)hi"), vector<string>({"a.b", "cde", "hi"}));
+    ASSERT_EQ(TrigramIndex::literals("(a[)]b)cde"), vector<string>({"cde"}));
+    ASSERT_EQ(TrigramIndex::literals("ab)cd"), vector<string>({"ab", "cd"}));
+    ASSERT_EQ(TrigramIndex::literals("yo{1,2}u"), vector<string>({"y", "u"}));
+    ASSERT_EQ(TrigramIndex::literals("ab{2}cd"), vector<string>({"a", "cd"}));
+    ASSERT_EQ(TrigramIndex::literals("\\x68arry"), vector<string>({"arry"}));
+    ASSERT_EQ(TrigramIndex::literals("\\u0068arry"), vector<string>({"arry"}));
+    ASSERT_EQ(TrigramIndex::literals("ab\\cJcd"), vector<string>({"ab", "cd"}));
+    ASSERT_EQ(TrigramIndex::literals("ab\\0cd"), vector<string>({"ab", "cd"}));
+    ASSERT_TRUE(TrigramIndex::literals("foo|bar").empty());
+    ASSERT_TRUE(TrigramIndex::literals(".*").empty());
+}
+
+TEST(TrigramIndexTest, Candidates) {
+    TrigramIndex index;
+    index.add(0, 0, "hello world");
+    index.add(0, 1, "yellow");
+    index.add(2, 3, "jello");
+    index.add(2, 4, "he");
+
+    PostingVectorType candidates;
+    ASSERT_TRUE(index.candidates({"ello"}, candidates));
+    ASSERT_EQ(candidates, PostingVectorType({{0, 0}, {0, 1}, {2, 3}}));
+    ASSERT_TRUE(index.candidates({"ello", "wor"}, candidates));
+    ASSERT_EQ(candidates, PostingVectorType({{0, 0}}));
+    ASSERT_TRUE(index.candidates({"zzz"}, candidates));
+    ASSERT_TRUE(candidates.empty());
+    ASSERT_FALSE(index.candidates({"he", "lo"}, candidates));
+
+    TrigramIndex second;
+    second.add(3, 0, "mellow");
+    index.append(second);
+    ASSERT_TRUE(index.candidates({"llow"}, candidates));
+    ASSERT_EQ(candidates, PostingVectorType({{0, 1}, {3, 0}}));
+}
+
+TEST(TrigramIndexTest, SearchSubstring) {
+    writeCorpus();
+    IndexBuilder plain((Tokenizer()));
+    plain.build("dump/trigram_documents");
+    IndexBuilder indexed((Tokenizer()));
+    indexed.build("dump/trigram_documents", 1, true);
+    IndexBuilder parallel((Tokenizer()));
+    parallel.build("dump/trigram_documents", 3, true);
+    ASSERT_FALSE(plain.hasTrigrams());
+    ASSERT_TRUE(indexed.hasTrigrams());
+    ASSERT_EQ(indexed.trigrams(), parallel.trigrams());
+
+    for (const string pattern : {"o_bar3", "id10", "d5", "1 foo", "x", "", "nothing"}) {
+        auto expected = scan([&pattern] (const string& line) { return line.find(pattern) != string::npos; });
+        ASSERT_EQ(plain.searchSubstring(pattern), expected);
+        ASSERT_EQ(indexed.searchSubstring(pattern), expected);
+        ASSERT_EQ(parallel.searchSubstring(pattern), expected);
+    }
+}
+
+TEST(TrigramIndexTest, SearchRegex) {
+    writeCorpus();
+    IndexBuilder indexBuilder((Tokenizer()));
+    indexBuilder.build("dump/trigram_documents", 1, true);
+
+    for (const string pattern : {"id1\\d3 ", "bar[25]", "^id2.*bar0", "foo|x$", "o_+bar(1|6)", "fo{1,2}_bar3",
+                                 "id1{2}0", "\\x66oo_bar3", "\\u0066oo_bar[14]", "x\\0?$",
+                                 "(a[)]b)cde", "(o[)_]b)ar3", "(id[)]1)0"}) {
+        regex re(pattern);
+        auto expected = scan([&re] (const string& line) { return regex_search(line, re); });
+        ASSERT_EQ(indexBuilder.searchRegex(pattern), expected);
+    }
+    ASSERT_THROW(indexBuilder.searchRegex("foo(bar"), InvalidQuery);
+
+    IndexBuilder plain((Tokenizer()));
+    plain.build("data/documents");
+    IndexBuilder indexed((Tokenizer()));
+    indexed.build("data/documents", 1, true);
+    for (const string pattern : {"yo{1,2}u", "\\x68arry", "\\u0068arry"}) {
+        ASSERT_FALSE(plain.searchRegex(pattern).empty());
+        ASSERT_EQ(indexed.searchRegex(pattern), plain.searchRegex(pattern));
+    }
+
+    Serializer serializer;
+    serializer.serialize("dump/trigram_index", indexBuilder);
+    IndexBuilder loaded((Tokenizer()));
+    serializer.deserialize("dump/trigram_index", loaded);
+    ASSERT_TRUE(loaded == indexBuilder);
+    ASSERT_EQ(loaded.searchRegex("bar[25]"), indexBuilder.searchRegex("bar[25]"));
+}